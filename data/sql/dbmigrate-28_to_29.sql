@@ -0,0 +1,7 @@
+-- Script to migate from db version 28 to 29.
+-- The scanner now skips dirs with unchanged mtimes, drop whatever old
+-- versions left in dirs_scanned so every dir gets listed once more.
+
+DELETE FROM dirs_scanned;
+
+UPDATE settings SET v = '29' WHERE k == 'schema_version';
@@ -0,0 +1,12 @@
+-- Script to migate from db version 29 to 30.
+-- Covering indexes for playback history, charts and social actions, so
+-- they can be read in index order instead of sorting the whole table.
+
+DROP INDEX IF EXISTS playback_log_source;
+CREATE INDEX IF NOT EXISTS playback_log_source_playtime ON playback_log(source, playtime, track);
+CREATE INDEX IF NOT EXISTS playback_log_playtime ON playback_log(playtime, track, source);
+
+DROP INDEX IF EXISTS social_attrib_id;
+CREATE INDEX IF NOT EXISTS social_attrib_id_timestamp ON social_attributes(id, timestamp);
+
+UPDATE settings SET v = '30' WHERE k == 'schema_version';
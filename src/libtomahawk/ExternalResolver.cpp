@@ -18,6 +18,12 @@
 
 #include "ExternalResolver.h"
 
+#include "album.h"
+#include "artist.h"
+#include "pipeline.h"
+#include "result.h"
+#include "database/database.h"
+#include "database/databasecommand_loadresultids.h"
 #include "utils/logger.h"
 
 Tomahawk::ExternalResolver::ErrorState
@@ -25,3 +31,36 @@ Tomahawk::ExternalResolver::error() const
 {
     return NoError;
 }
+
+
+void
+Tomahawk::ExternalResolver::reportResultsWithIds( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results )
+{
+    if ( results.isEmpty() || !Database::instance() )
+    {
+        Tomahawk::Pipeline::instance()->reportResults( qid, results, this );
+        return;
+    }
+
+    // look up the artist & album ids in the database thread, not in ours
+    DatabaseCommand_LoadResultIds* cmd = new DatabaseCommand_LoadResultIds( qid, results );
+    connect( cmd, SIGNAL( done( Tomahawk::QID, QList< Tomahawk::result_ptr >, QList< Tomahawk::artist_ptr >, QList< Tomahawk::album_ptr > ) ),
+                    SLOT( onResultIdsLoaded( Tomahawk::QID, QList< Tomahawk::result_ptr >, QList< Tomahawk::artist_ptr >, QList< Tomahawk::album_ptr > ) ),
+                    Qt::QueuedConnection );
+
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+}
+
+
+void
+Tomahawk::ExternalResolver::onResultIdsLoaded( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results,
+                                               const QList< Tomahawk::artist_ptr >& artists, const QList< Tomahawk::album_ptr >& albums )
+{
+    for ( int i = 0; i < results.count(); i++ )
+    {
+        results.at( i )->setArtist( artists.at( i ) );
+        results.at( i )->setAlbum( albums.at( i ) );
+    }
+
+    Tomahawk::Pipeline::instance()->reportResults( qid, results, this );
+}
@@ -71,6 +71,13 @@ signals:
 protected:
     void setFilePath( const QString& path ) { m_filePath = path; }
 
+    /// Looks up the artist & album ids of the results in the database thread, then reports them to the Pipeline
+    void reportResultsWithIds( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results );
+
+private slots:
+    void onResultIdsLoaded( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results,
+                            const QList< Tomahawk::artist_ptr >& artists, const QList< Tomahawk::album_ptr >& albums );
+
 private:
     QString m_filePath;
 };
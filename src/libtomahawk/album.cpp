@@ -26,15 +26,22 @@
 #include "query.h"
 
 #include "utils/logger.h"
+#include "utils/WeakCache.h"
+#ifndef ENABLE_HEADLESS
+    #include "utils/tomahawkutilsgui.h"
+#endif
 
 using namespace Tomahawk;
 
+// albums with a database id are shared, as long as someone uses them
+static TomahawkUtils::WeakCache< Album > s_albums;
+static QAtomicInt s_albumCount;
+
 
 Album::~Album()
 {
-#ifndef ENABLE_HEADLESS
-    delete m_cover;
-#endif
+    if ( m_id > 0 )
+        s_albums.purge( m_id );
 }
 
 
@@ -55,19 +62,22 @@ Album::get( const Tomahawk::artist_ptr& artist, const QString& name, bool autoCr
 album_ptr
 Album::get( unsigned int id, const QString& name, const Tomahawk::artist_ptr& artist )
 {
-    static QHash< unsigned int, album_ptr > s_albums;
-    static QMutex s_mutex;
+    if ( id == 0 )
+        return album_ptr( new Album( id, name, artist ), &QObject::deleteLater );
 
-    QMutexLocker lock( &s_mutex );
-    if ( s_albums.contains( id ) )
+    album_ptr a = s_albums.value( id );
+    if ( !a.isNull() )
+        return a;
+
+    a = s_albums.insert( id, album_ptr( new Album( id, name, artist ), &QObject::deleteLater ) );
+
+    if ( s_albumCount.fetchAndAddRelaxed( 1 ) % 1000 == 999 )
     {
-        return s_albums.value( id );
+        const TomahawkUtils::WeakCache< Album >::Stats stats = s_albums.stats();
+        tDebug( LOGVERBOSE ) << "Album cache: hits" << stats.hits << "misses" << stats.misses
+                             << "evictions" << stats.evictions << "size" << stats.size;
     }
 
-    album_ptr a = album_ptr( new Album( id, name, artist ), &QObject::deleteLater );
-    if ( id > 0 )
-        s_albums.insert( id, a );
-
     return a;
 }
 
@@ -79,9 +89,6 @@ Album::Album( unsigned int id, const QString& name, const Tomahawk::artist_ptr&
     , m_artist( artist )
     , m_infoLoaded( false )
     , m_infoLoading( false )
-#ifndef ENABLE_HEADLESS
-    , m_cover( 0 )
-#endif
 {
 }
 
@@ -138,29 +145,8 @@ Album::cover( const QSize& size, bool forceLoad ) const
         m_infoLoading = true;
     }
 
-    if ( !m_cover && !m_coverBuffer.isEmpty() )
-    {
-        m_cover = new QPixmap();
-        m_cover->loadFromData( m_coverBuffer );
-    }
-
-    if ( m_cover && !m_cover->isNull() && !size.isEmpty() )
-    {
-        if ( m_coverCache.contains( size.width() ) )
-        {
-            return m_coverCache.value( size.width() );
-        }
-
-        QPixmap scaledCover;
-        scaledCover = m_cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-        m_coverCache.insert( size.width(), scaledCover );
-        return scaledCover;
-    }
-
-    if ( m_cover )
-        return *m_cover;
-    else
-        return QPixmap();
+    // decoded covers live in a shared cache of limited size, m_uuid is unique to us
+    return TomahawkUtils::cachedCover( m_uuid, m_coverBuffer, size );
 }
 #endif
 
@@ -79,11 +79,6 @@ private:
     mutable bool m_infoLoading;
     mutable QString m_uuid;
 
-#ifndef ENABLE_HEADLESS
-    mutable QPixmap* m_cover;
-    mutable QHash< int, QPixmap > m_coverCache;
-#endif
-
     Tomahawk::playlistinterface_ptr m_playlistInterface;
 };
 
@@ -64,6 +64,17 @@ AlbumPlaylistInterface::siblingItem( int itemsAway )
 }
 
 
+query_ptr
+AlbumPlaylistInterface::peekNextQuery()
+{
+    const int p = m_currentTrack + 1;
+    if ( p < 0 || p >= m_queries.count() )
+        return Tomahawk::query_ptr();
+
+    return m_queries.at( p );
+}
+
+
 result_ptr
 AlbumPlaylistInterface::currentItem() const
 {
@@ -47,6 +47,7 @@ public:
     virtual Tomahawk::result_ptr siblingItem( int itemsAway );
 
     virtual bool hasNextItem();
+    virtual Tomahawk::query_ptr peekNextQuery();
     virtual Tomahawk::result_ptr currentItem() const;
 
     virtual PlaylistInterface::RepeatMode repeatMode() const { return PlaylistInterface::NoRepeat; }
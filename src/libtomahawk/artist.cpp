@@ -26,15 +26,22 @@
 #include "query.h"
 
 #include "utils/logger.h"
+#include "utils/WeakCache.h"
+#ifndef ENABLE_HEADLESS
+    #include "utils/tomahawkutilsgui.h"
+#endif
 
 using namespace Tomahawk;
 
+// artists with a database id are shared, as long as someone uses them
+static TomahawkUtils::WeakCache< Artist > s_artists;
+static QAtomicInt s_artistCount;
+
 
 Artist::~Artist()
 {
-#ifndef ENABLE_HEADLESS
-    delete m_cover;
-#endif
+    if ( m_id > 0 )
+        s_artists.purge( m_id );
 }
 
 
@@ -55,19 +62,22 @@ Artist::get( const QString& name, bool autoCreate )
 artist_ptr
 Artist::get( unsigned int id, const QString& name )
 {
-    static QHash< unsigned int, artist_ptr > s_artists;
-    static QMutex s_mutex;
+    if ( id == 0 )
+        return artist_ptr( new Artist( id, name ), &QObject::deleteLater );
 
-    QMutexLocker lock( &s_mutex );
-    if ( s_artists.contains( id ) )
+    artist_ptr a = s_artists.value( id );
+    if ( !a.isNull() )
+        return a;
+
+    a = s_artists.insert( id, artist_ptr( new Artist( id, name ), &QObject::deleteLater ) );
+
+    if ( s_artistCount.fetchAndAddRelaxed( 1 ) % 1000 == 999 )
     {
-        return s_artists.value( id );
+        const TomahawkUtils::WeakCache< Artist >::Stats stats = s_artists.stats();
+        tDebug( LOGVERBOSE ) << "Artist cache: hits" << stats.hits << "misses" << stats.misses
+                             << "evictions" << stats.evictions << "size" << stats.size;
     }
 
-    artist_ptr a = artist_ptr( new Artist( id, name ), &QObject::deleteLater );
-    if ( id > 0 )
-        s_artists.insert( id, a );
-
     return a;
 }
 
@@ -78,9 +88,6 @@ Artist::Artist( unsigned int id, const QString& name )
     , m_name( name )
     , m_infoLoaded( false )
     , m_infoLoading( false )
-#ifndef ENABLE_HEADLESS
-    , m_cover( 0 )
-#endif
 {
     m_sortname = DatabaseImpl::sortname( name, true );
 }
@@ -128,29 +135,8 @@ Artist::cover( const QSize& size, bool forceLoad ) const
         m_infoLoading = true;
     }
 
-    if ( !m_cover && !m_coverBuffer.isEmpty() )
-    {
-        m_cover = new QPixmap();
-        m_cover->loadFromData( m_coverBuffer );
-    }
-
-    if ( m_cover && !m_cover->isNull() && !size.isEmpty() )
-    {
-        if ( m_coverCache.contains( size.width() ) )
-        {
-            return m_coverCache.value( size.width() );
-        }
-
-        QPixmap scaledCover;
-        scaledCover = m_cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-        m_coverCache.insert( size.width(), scaledCover );
-        return scaledCover;
-    }
-
-    if ( m_cover )
-        return *m_cover;
-    else
-        return QPixmap();
+    // decoded covers live in a shared cache of limited size, m_uuid is unique to us
+    return TomahawkUtils::cachedCover( m_uuid, m_coverBuffer, size );
 }
 #endif
 
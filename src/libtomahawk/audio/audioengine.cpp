@@ -26,6 +26,7 @@
 #include <QTemporaryFile>
 
 #include "playlistinterface.h"
+#include "pipeline.h"
 #include "sourceplaylistinterface.h"
 #include "tomahawksettings.h"
 #include "database/database.h"
@@ -40,6 +41,9 @@
 #include "utils/logger.h"
 
 
+// how long before the end of a track the next one gets opened, so its stream is buffered by then
+#define PREFETCH_SECONDS 10
+
 using namespace Tomahawk;
 
 AudioEngine* AudioEngine::s_instance = 0;
@@ -60,6 +64,7 @@ AudioEngine::AudioEngine()
     , m_timeElapsed( 0 )
     , m_expectStop( false )
     , m_waitingOnNewTrack( false )
+    , m_prefetchEnqueued( false )
     , m_state( Stopped )
 {
     s_instance = this;
@@ -76,6 +81,7 @@ AudioEngine::AudioEngine()
     connect( m_mediaObject, SIGNAL( stateChanged( Phonon::State, Phonon::State ) ), SLOT( onStateChanged( Phonon::State, Phonon::State ) ) );
     connect( m_mediaObject, SIGNAL( tick( qint64 ) ), SLOT( timerTriggered( qint64 ) ) );
     connect( m_mediaObject, SIGNAL( aboutToFinish() ), SLOT( onAboutToFinish() ) );
+    connect( m_mediaObject, SIGNAL( currentSourceChanged( Phonon::MediaSource ) ), SLOT( onCurrentSourceChanged( Phonon::MediaSource ) ) );
 
     connect( m_audioOutput, SIGNAL( volumeChanged( qreal ) ), SLOT( onVolumeChanged( qreal ) ) );
 
@@ -167,6 +173,7 @@ AudioEngine::stop()
         return;
 
     setState( Stopped );
+    clearPrefetch();
     m_mediaObject->stop();
 
     if ( !m_playlist.isNull() )
@@ -408,7 +415,15 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
 
             if ( !isHttpResult( m_currentTrack->url() ) && !isLocalResult( m_currentTrack->url() ) )
             {
-                io = Servent::instance()->getIODeviceForUrl( m_currentTrack );
+                // we might have opened this one already. once it was enqueued, phonon may have
+                // read from it and owns a stream on top of it, so then we ask for a fresh one
+                if ( m_prefetchTrack == result && !m_prefetchEnqueued )
+                {
+                    io = m_prefetchInput;
+                    m_prefetchInput.clear();
+                }
+                if ( io.isNull() )
+                    io = Servent::instance()->getIODeviceForUrl( m_currentTrack );
 
                 if ( !io || io.isNull() )
                 {
@@ -418,72 +433,96 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
             }
         }
 
+        clearPrefetch();
+
         if ( !err )
         {
             tLog() << "Starting new song:" << m_currentTrack->url();
             emit loading( m_currentTrack );
 
-            if ( !isHttpResult( m_currentTrack->url() ) && !isLocalResult( m_currentTrack->url() ) )
+            m_mediaObject->setCurrentSource( mediaSourceFor( m_currentTrack, io ) );
+            m_mediaObject->play();
+
+            trackStarted( io );
+        }
+    }
+
+    if ( err )
+    {
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+
+Phonon::MediaSource
+AudioEngine::mediaSourceFor( const Tomahawk::result_ptr& result, const QSharedPointer<QIODevice>& io )
+{
+    Phonon::MediaSource source;
+
+    if ( !isHttpResult( result->url() ) && !isLocalResult( result->url() ) )
+    {
+        if ( QNetworkReply* qnr_io = qobject_cast< QNetworkReply* >( io.data() ) )
+            source = Phonon::MediaSource( new QNR_IODeviceStream( qnr_io, this ) );
+        else
+            source = Phonon::MediaSource( io.data() );
+        source.setAutoDelete( false );
+    }
+    else
+    {
+        if ( !isLocalResult( result->url() ) )
+        {
+            QUrl furl = result->url();
+            if ( result->url().contains( "?" ) )
             {
-                if ( QNetworkReply* qnr_io = qobject_cast< QNetworkReply* >( io.data() ) )
-                    m_mediaObject->setCurrentSource( new QNR_IODeviceStream( qnr_io, this ) );
-                else
-                    m_mediaObject->setCurrentSource( io.data() );
-                m_mediaObject->currentSource().setAutoDelete( false );
+                furl = QUrl( result->url().left( result->url().indexOf( '?' ) ) );
+                furl.setEncodedQuery( QString( result->url().mid( result->url().indexOf( '?' ) + 1 ) ).toLocal8Bit() );
             }
-            else
-            {
-                if ( !isLocalResult( m_currentTrack->url() ) )
-                {
-                    QUrl furl = m_currentTrack->url();
-                    if ( m_currentTrack->url().contains( "?" ) )
-                    {
-                        furl = QUrl( m_currentTrack->url().left( m_currentTrack->url().indexOf( '?' ) ) );
-                        furl.setEncodedQuery( QString( m_currentTrack->url().mid( m_currentTrack->url().indexOf( '?' ) + 1 ) ).toLocal8Bit() );
-                    }
-                    m_mediaObject->setCurrentSource( furl );
-                }
-                else
-                {
-                    QString furl = m_currentTrack->url();
+            source = Phonon::MediaSource( furl );
+        }
+        else
+        {
+            QString furl = result->url();
 #ifdef Q_WS_WIN
-                    if ( furl.startsWith( "file://" ) )
-                        furl = furl.right( furl.length() - 7 );
+            if ( furl.startsWith( "file://" ) )
+                furl = furl.right( furl.length() - 7 );
 #endif
-                    tLog( LOGVERBOSE ) << "Passing to Phonon:" << furl << furl.toLatin1();
-                    m_mediaObject->setCurrentSource( furl );
-                }
+            tLog( LOGVERBOSE ) << "Passing to Phonon:" << furl << furl.toLatin1();
+            source = Phonon::MediaSource( furl );
+        }
 
-                m_mediaObject->currentSource().setAutoDelete( true );
-            }
+        source.setAutoDelete( true );
+    }
 
-            if ( !m_input.isNull() )
-            {
-                m_input->close();
-                m_input.clear();
-            }
-            m_input = io;
-            m_mediaObject->play();
-            emit started( m_currentTrack );
+    return source;
+}
 
-            if ( TomahawkSettings::instance()->privateListeningMode() != TomahawkSettings::FullyPrivate )
-            {
-                DatabaseCommand_LogPlayback* cmd = new DatabaseCommand_LogPlayback( m_currentTrack, DatabaseCommand_LogPlayback::Started );
-                Database::instance()->enqueue( QSharedPointer<DatabaseCommand>(cmd) );
-            }
-            
-            sendNowPlayingNotification( Tomahawk::InfoSystem::InfoNowPlaying );
-        }
+
+void
+AudioEngine::trackStarted( const QSharedPointer<QIODevice>& io )
+{
+    if ( !m_input.isNull() )
+    {
+        m_input->close();
+        m_input.clear();
     }
+    m_input = io;
 
-    if ( err )
+    emit started( m_currentTrack );
+
+    if ( TomahawkSettings::instance()->privateListeningMode() != TomahawkSettings::FullyPrivate )
     {
-        stop();
-        return false;
+        DatabaseCommand_LogPlayback* cmd = new DatabaseCommand_LogPlayback( m_currentTrack, DatabaseCommand_LogPlayback::Started );
+        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>(cmd) );
     }
 
+    sendNowPlayingNotification( Tomahawk::InfoSystem::InfoNowPlaying );
+
     m_waitingOnNewTrack = false;
-    return true;
+
+    resolveNextTrack();
 }
 
 
@@ -523,6 +562,28 @@ AudioEngine::loadNextTrack()
         }
     }
 
+    result = takeNextTrack();
+
+    if ( !result.isNull() )
+    {
+        tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Got next item, loading track";
+        loadTrack( result );
+    }
+    else
+    {
+        if ( !m_playlist.isNull() && m_playlist.data()->retryMode() == Tomahawk::PlaylistInterface::Retry )
+            m_waitingOnNewTrack = true;
+
+        stop();
+    }
+}
+
+
+Tomahawk::result_ptr
+AudioEngine::takeNextTrack()
+{
+    Tomahawk::result_ptr result;
+
     if ( m_queue && m_queue->trackCount() )
     {
         result = m_queue->nextItem();
@@ -535,18 +596,104 @@ AudioEngine::loadNextTrack()
         m_currentTrackPlaylist = m_playlist;
     }
 
-    if ( !result.isNull() )
+    return result;
+}
+
+
+Tomahawk::query_ptr
+AudioEngine::peekNextQuery() const
+{
+    if ( m_queue && m_queue->trackCount() )
+        return m_queue->peekNextQuery();
+    if ( !m_playlist.isNull() )
+        return m_playlist.data()->peekNextQuery();
+
+    return Tomahawk::query_ptr();
+}
+
+
+void
+AudioEngine::resolveNextTrack()
+{
+    if ( !m_nextQuery.isNull() )
+        disconnect( m_nextQuery.data(), SIGNAL( playableStateChanged( bool ) ), this, SLOT( onNextQueryPlayable( bool ) ) );
+
+    m_nextQuery = peekNextQuery();
+    if ( m_nextQuery.isNull() || m_nextQuery->playable() )
+        return;
+
+    connect( m_nextQuery.data(), SIGNAL( playableStateChanged( bool ) ), SLOT( onNextQueryPlayable( bool ) ) );
+    Pipeline::instance()->resolve( m_nextQuery, Pipeline::NextUp );
+}
+
+
+void
+AudioEngine::onNextQueryPlayable( bool playable )
+{
+    // resolved after we'd have liked to prefetch it already
+    if ( playable && nearTrackEnd() )
+        prefetchNextTrack();
+}
+
+
+bool
+AudioEngine::nearTrackEnd() const
+{
+    if ( m_currentTrack.isNull() )
+        return false;
+
+    const qint64 duration = m_mediaObject->totalTime() > 0 ? m_mediaObject->totalTime() / 1000 : m_currentTrack->duration();
+    return duration > 0 && duration - m_timeElapsed <= PREFETCH_SECONDS;
+}
+
+
+void
+AudioEngine::prefetchNextTrack()
+{
+    if ( !m_prefetchTrack.isNull() || m_currentTrack.isNull() || !canGoNext() )
+        return;
+
+    if ( !m_stopAfterTrack.isNull() && m_stopAfterTrack->equals( m_currentTrack->toQuery() ) )
+        return;
+
+    // not resolved yet, onNextQueryPlayable() gets us back here once it is
+    const Tomahawk::query_ptr query = peekNextQuery();
+    if ( query.isNull() || !query->playable() )
+        return;
+
+    Tomahawk::result_ptr result = query->results().first();
+    if ( result == m_currentTrack )
+        return;
+
+    // opening the stream now lets it buffer while the current track plays out
+    if ( !isHttpResult( result->url() ) && !isLocalResult( result->url() ) )
     {
-        tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Got next item, loading track";
-        loadTrack( result );
+        m_prefetchInput = Servent::instance()->getIODeviceForUrl( result );
+        if ( m_prefetchInput.isNull() )
+            return;
     }
-    else
+
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Prefetching next track:" << result->url();
+    m_prefetchTrack = result;
+}
+
+
+void
+AudioEngine::clearPrefetch()
+{
+    if ( m_prefetchEnqueued )
     {
-        if ( !m_playlist.isNull() && m_playlist.data()->retryMode() == Tomahawk::PlaylistInterface::Retry )
-            m_waitingOnNewTrack = true;
+        m_mediaObject->clearQueue();
+        m_prefetchEnqueued = false;
+    }
 
-        stop();
+    if ( !m_prefetchInput.isNull() )
+    {
+        m_prefetchInput->close();
+        m_prefetchInput.clear();
     }
+
+    m_prefetchTrack.clear();
 }
 
 
@@ -600,6 +747,58 @@ AudioEngine::onAboutToFinish()
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
     m_expectStop = true;
+
+    prefetchNextTrack();
+    if ( m_prefetchTrack.isNull() || m_prefetchEnqueued )
+        return;
+
+    // hand the next track to phonon right away, it continues with it without a gap.
+    // if the backend stops anyway, loadNextTrack() plays it the usual way
+    m_mediaObject->enqueue( mediaSourceFor( m_prefetchTrack, m_prefetchInput ) );
+    m_prefetchEnqueued = true;
+}
+
+
+void
+AudioEngine::onCurrentSourceChanged( const Phonon::MediaSource& source )
+{
+    Q_UNUSED( source );
+
+    // only interesting when phonon moved on to a track we enqueued
+    if ( !m_prefetchEnqueued )
+        return;
+
+    m_prefetchEnqueued = false;
+    m_expectStop = false;
+
+    if ( !m_stopAfterTrack.isNull() && m_stopAfterTrack->equals( m_currentTrack->toQuery() ) )
+    {
+        m_stopAfterTrack.clear();
+        stop();
+        return;
+    }
+
+    Tomahawk::result_ptr result = takeNextTrack();
+    if ( result.isNull() || result != m_prefetchTrack )
+    {
+        // the playlist changed since we prefetched
+        tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Enqueued track is no longer next";
+        if ( result.isNull() )
+            stop();
+        else
+            loadTrack( result );
+        return;
+    }
+
+    QSharedPointer<QIODevice> io = m_prefetchInput;
+    m_prefetchInput.clear();
+    m_prefetchTrack.clear();
+
+    setCurrentTrack( result );
+    tLog() << "Continuing gapless with:" << m_currentTrack->url();
+    emit loading( m_currentTrack );
+
+    trackStarted( io );
 }
 
 
@@ -679,6 +878,9 @@ AudioEngine::timerTriggered( qint64 time )
             {
                 emit timerPercentage( ( (double)m_timeElapsed / (double)m_currentTrack->duration() ) * 100.0 );
             }
+
+            if ( nearTrackEnd() )
+                prefetchNextTrack();
         }
     }
 }
@@ -690,6 +892,9 @@ AudioEngine::setPlaylist( Tomahawk::playlistinterface_ptr playlist )
     if ( m_playlist == playlist )
         return;
 
+    // whatever we prefetched came from the old playlist
+    clearPrefetch();
+
     if ( !m_playlist.isNull() )
     {
         if ( m_playlist.data() && m_playlist.data()->retryMode() == PlaylistInterface::Retry )
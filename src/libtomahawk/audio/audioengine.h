@@ -125,6 +125,8 @@ private slots:
     void loadNextTrack();
 
     void onAboutToFinish();
+    void onCurrentSourceChanged( const Phonon::MediaSource& source );
+    void onNextQueryPlayable( bool playable );
     void onStateChanged( Phonon::State newState, Phonon::State oldState );
     void onVolumeChanged( qreal volume ) { emit volumeChanged( volume * 100 ); }
     void timerTriggered( qint64 time );
@@ -138,6 +140,16 @@ private slots:
 private:
     void setState( AudioState state );
 
+    Tomahawk::result_ptr takeNextTrack();
+    Phonon::MediaSource mediaSourceFor( const Tomahawk::result_ptr& result, const QSharedPointer<QIODevice>& io );
+    void trackStarted( const QSharedPointer<QIODevice>& io );
+
+    Tomahawk::query_ptr peekNextQuery() const;
+    void resolveNextTrack();
+    bool nearTrackEnd() const;
+    void prefetchNextTrack();
+    void clearPrefetch();
+
     bool isHttpResult( const QString& ) const;
     bool isLocalResult( const QString& ) const;
 
@@ -145,6 +157,13 @@ private:
 
     QSharedPointer<QIODevice> m_input;
 
+    // the query expected to play next, resolved as soon as the current track starts
+    Tomahawk::query_ptr m_nextQuery;
+    // the track expected to play next, opened ahead of time so it can follow without a gap
+    Tomahawk::result_ptr m_prefetchTrack;
+    QSharedPointer<QIODevice> m_prefetchInput;
+    bool m_prefetchEnqueued;
+
     Tomahawk::query_ptr m_stopAfterTrack;
     Tomahawk::result_ptr m_currentTrack;
     Tomahawk::playlistinterface_ptr m_playlist;
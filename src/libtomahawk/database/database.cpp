@@ -22,6 +22,7 @@
 #include "databasecommand.h"
 #include "databaseimpl.h"
 #include "databaseworker.h"
+#include "tomahawksettings.h"
 #include "utils/logger.h"
 
 #define DEFAULT_WORKER_THREADS 4
@@ -41,12 +42,15 @@ Database::Database( const QString& dbname, QObject* parent )
     : QObject( parent )
     , m_ready( false )
     , m_impl( new DatabaseImpl( dbname, this ) )
-    , m_workerRW( new DatabaseWorker( m_impl, this, true ) )
+    , m_connectionPerWorker( TomahawkSettings::instance()->dbConnectionPerWorker() )
 {
     s_instance = this;
 
+    m_workerRW = new DatabaseWorker( m_impl, this, true, m_connectionPerWorker );
+
     m_maxConcurrentThreads = qBound( DEFAULT_WORKER_THREADS, QThread::idealThreadCount(), MAX_WORKER_THREADS );
-    qDebug() << Q_FUNC_INFO << "Using" << m_maxConcurrentThreads << "threads";
+    qDebug() << Q_FUNC_INFO << "Using" << m_maxConcurrentThreads << "threads"
+             << ( m_connectionPerWorker ? "with one connection each" : "sharing one connection" );
 
     connect( m_impl, SIGNAL( indexReady() ), SIGNAL( indexReady() ) );
     connect( m_impl, SIGNAL( indexReady() ), SIGNAL( ready() ) );
@@ -95,7 +99,7 @@ Database::enqueue( const QSharedPointer<DatabaseCommand>& lc )
         // create new thread if < WORKER_THREADS
         if ( m_workers.count() < m_maxConcurrentThreads )
         {
-            DatabaseWorker* worker = new DatabaseWorker( m_impl, this, false );
+            DatabaseWorker* worker = new DatabaseWorker( m_impl, this, false, m_connectionPerWorker );
             worker->start();
 
             m_workers << worker;
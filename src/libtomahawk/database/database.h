@@ -41,6 +41,9 @@ class DatabaseWorker;
     the queue of work. There is a threadpool responsible for exec'ing all
     the non-mutating (readonly) commands and one separate thread for mutating ones,
     so sqlite doesn't write to the Database from multiple threads.
+
+    Unless disabled in the settings, every worker opens its own sqlite connection
+    and the database runs in WAL mode, so readers don't wait for the rw worker.
 */
 class DLLEXPORT Database : public QObject
 {
@@ -59,6 +62,9 @@ public:
 
     bool isReady() const { return m_ready; }
 
+    /// The search index is updated incrementally by AddFiles / DeleteFiles, this announces a finished batch of changes
+    void notifyIndexChanged() { emit indexReady(); }
+
 signals:
     void indexReady(); // search index
     void ready();
@@ -82,6 +88,7 @@ private:
     QList<DatabaseWorker*> m_workers;
     bool m_indexReady;
     int m_maxConcurrentThreads;
+    bool m_connectionPerWorker;
 
     static Database* s_instance;
 
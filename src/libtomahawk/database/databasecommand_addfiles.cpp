@@ -55,6 +55,15 @@ DatabaseCommand_AddFiles::files() const
 void
 DatabaseCommand_AddFiles::postCommitHook()
 {
+    // only now the rows are there for sure, a rolled back transaction must not leave them in the index
+    if ( !m_indexTracks.isEmpty() || !m_indexAlbums.isEmpty() )
+    {
+        FuzzyIndex* index = Database::instance()->impl()->m_fuzzyIndex;
+        index->updateFields( m_indexTracks );
+        index->updateFields( m_indexAlbums );
+        source()->updateIndexWhenSynced();
+    }
+
     // make the collection object emit its tracksAdded signal, so the
     // collection browser will update/fade in etc.
     Collection* coll = source()->collection().data();
@@ -75,13 +84,9 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
     qDebug() << Q_FUNC_INFO;
     Q_ASSERT( !source().isNull() );
 
-    TomahawkSqlQuery query_file = dbi->newquery();
-    TomahawkSqlQuery query_filejoin = dbi->newquery();
-    TomahawkSqlQuery query_trackattr = dbi->newquery();
-
-    query_file.prepare( "INSERT INTO file(source, url, size, mtime, md5, mimetype, duration, bitrate) VALUES (?, ?, ?, ?, ?, ?, ?, ?)" );
-    query_filejoin.prepare( "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber) VALUES (?, ?, ?, ?, ?, ?, ?)" );
-    query_trackattr.prepare( "INSERT INTO track_attributes(id, k, v) VALUES (?, ?, ?)" );
+    TomahawkSqlQuery query_file = dbi->preparedQuery( "INSERT INTO file(source, url, size, mtime, md5, mimetype, duration, bitrate) VALUES (?, ?, ?, ?, ?, ?, ?, ?)" );
+    TomahawkSqlQuery query_filejoin = dbi->preparedQuery( "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber) VALUES (?, ?, ?, ?, ?, ?, ?)" );
+    TomahawkSqlQuery query_trackattr = dbi->preparedQuery( "INSERT INTO track_attributes(id, k, v) VALUES (?, ?, ?)" );
 
     int added = 0;
     QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
@@ -159,14 +164,26 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
         query_trackattr.bindValue( 2, year );
         query_trackattr.exec();
 
+        if ( !m_indexTracks.contains( trackid ) )
+        {
+            QMap< QString, QString > t;
+            t.insert( "track", track );
+            t.insert( "artist", artist );
+            t.insert( "artistid", QString::number( artistid ) );
+            m_indexTracks.insert( trackid, t );
+        }
+        if ( albumid > 0 && !m_indexAlbums.contains( albumid ) )
+        {
+            QMap< QString, QString > a;
+            a.insert( "album", album );
+            m_indexAlbums.insert( albumid, a );
+        }
+
         m_ids << fileid;
         added++;
     }
     qDebug() << "Inserted" << added << "tracks to database";
 
-    if ( added )
-        source()->updateIndexWhenSynced();
-
     tDebug() << "Committing" << added << "tracks...";
     emit done( m_files, source()->collection() );
 }
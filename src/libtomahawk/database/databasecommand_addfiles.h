@@ -48,6 +48,7 @@ public:
 
     virtual void exec( DatabaseImpl* );
     virtual bool doesMutates() const { return true; }
+    virtual bool groupable() const { return true; }
     virtual void postCommitHook();
 
     QVariantList files() const;
@@ -60,6 +61,9 @@ signals:
 private:
     QVariantList m_files;
     QList<unsigned int> m_ids;
+
+    // tracks & albums touched by this command, fed to the fuzzy index once committed
+    QMap< unsigned int, QMap< QString, QString > > m_indexTracks, m_indexAlbums;
 };
 
 #endif // DATABASECOMMAND_ADDFILES_H
@@ -32,6 +32,7 @@ DatabaseCommand_AllAlbums::DatabaseCommand_AllAlbums( const Tomahawk::collection
   , m_collection( collection )
   , m_artist( artist )
   , m_amount( 0 )
+  , m_afterAlbumId( 0 )
   , m_sortOrder( DatabaseCommand_AllAlbums::None )
   , m_sortDescending( false )
 {}
@@ -137,16 +138,24 @@ DatabaseCommand_AllAlbums::execForCollection( DatabaseImpl* dbi )
     if ( !m_collection.isNull() )
         sourceToken = QString( "AND file.source %1 " ).arg( m_collection->source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( m_collection->source()->id() ) );
 
+    // pages need a stable order, and the album id lets the next one start right where this one ends
+    QString pageToken;
+    if ( m_sortOrder == None && m_amount > 0 )
+        orderToken = "album.id";
+    if ( m_afterAlbumId > 0 )
+        pageToken = QString( "AND album.id > %1 " ).arg( m_afterAlbumId );
+
     QString sql = QString(
         "SELECT DISTINCT album.id, album.name, album.artist, artist.name "
         "FROM album, file, file_join "
         "LEFT OUTER JOIN artist ON album.artist = artist.id "
         "WHERE file.id = file_join.file "
         "AND file_join.album = album.id "
-        "%1 "
-        "%2 %3 %4"
+        "%1 %2 "
+        "%3 %4 %5"
         ).arg( sourceToken )
-         .arg( m_sortOrder > 0 ? QString( "ORDER BY %1" ).arg( orderToken ) : QString() )
+         .arg( pageToken )
+         .arg( !orderToken.isEmpty() ? QString( "ORDER BY %1" ).arg( orderToken ) : QString() )
          .arg( m_sortDescending ? "DESC" : QString() )
          .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
 
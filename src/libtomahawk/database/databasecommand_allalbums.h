@@ -52,6 +52,9 @@ public:
 
     void setArtist( const Tomahawk::artist_ptr& artist );
     void setLimit( unsigned int amount ) { m_amount = amount; }
+    // keyset paging for whole collections: without a sort order, limited results come ordered
+    // by album id. Pass the id of the last album of a page here to get the next one
+    void setAfterAlbumId( unsigned int albumId ) { m_afterAlbumId = albumId; }
     void setSortOrder( DatabaseCommand_AllAlbums::SortOrder order ) { m_sortOrder = order; }
     void setSortDescending( bool descending ) { m_sortDescending = descending; }
     void setFilter( const QString& filter ) { m_filter = filter; }
@@ -65,6 +68,7 @@ private:
     Tomahawk::artist_ptr m_artist;
 
     unsigned int m_amount;
+    unsigned int m_afterAlbumId;
     DatabaseCommand_AllAlbums::SortOrder m_sortOrder;
     bool m_sortDescending;
     QString m_filter;
@@ -27,6 +27,33 @@
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// sort keys of DatabaseCommand_AllTracks::Artist, in the order TrackProxyModel compares them
+#define ARTIST_SORT_COLUMNS "CASE WHEN substr( artist.sortname, 1, 4 ) = 'the ' THEN substr( artist.sortname, 5 ) ELSE artist.sortname END", \
+                            "IFNULL( album.name, '' )", \
+                            "MAX( 1, IFNULL( file_join.discnumber, 0 ) )", \
+                            "IFNULL( file_join.albumpos, 0 )", \
+                            "track.id", \
+                            "file.id"
+
+
+// ( a, b, c ) > ( ?, ?, ? ), spelled out. Binds each value twice but the last one
+static QString
+keysetCondition( const QStringList& columns )
+{
+    QString condition = QString( "%1 > ?" ).arg( columns.last() );
+    for ( int i = columns.count() - 2; i >= 0; i-- )
+        condition = QString( "%1 > ? OR ( %1 = ? AND ( %2 ) )" ).arg( columns.at( i ) ).arg( condition );
+
+    return QString( "AND ( %1 )" ).arg( condition );
+}
+
+
+bool
+DatabaseCommand_AllTracks::isPaged() const
+{
+    return m_amount > 0 && ( m_sortOrder == None || ( m_sortOrder == Artist && !m_sortDescending ) );
+}
+
 
 void
 DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
@@ -51,8 +78,26 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
         case AlbumPosition:
             m_orderToken = "file_join.discnumber, file_join.albumpos";
             break;
+
+        case Artist:
+            break;
     }
 
+    // pages need a stable order, ending with the file id. The key of the last row
+    // lets the next page start right where this one ends
+    QStringList keyColumns;
+    if ( m_sortOrder == Artist )
+        keyColumns << ARTIST_SORT_COLUMNS;
+    else if ( isPaged() )
+        keyColumns << "file.id";
+    // DESC follows the last column, the others need it too
+    if ( !keyColumns.isEmpty() )
+        m_orderToken = keyColumns.join( m_sortDescending ? " DESC, " : ", " );
+
+    QString pageToken;
+    if ( isPaged() && m_pageKey.count() == keyColumns.count() )
+        pageToken = keysetCondition( keyColumns );
+
     if ( !m_collection.isNull() )
         sourceToken = QString( "AND file.source %1" ).arg( m_collection->source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( m_collection->source()->id() ) );
 
@@ -72,7 +117,8 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
             "SELECT file.id, artist.name, album.name, track.name, composer.name, file.size, "   //0
                    "file.duration, file.bitrate, file.url, file.source, file.mtime, "           //6
                    "file.mimetype, file_join.discnumber, file_join.albumpos, artist.id, "       //11
-                   "album.id, track.id, composer.id "                                           //15
+                   "album.id, track.id, composer.id, "                                          //15
+                   "%8 "                                                                        //18
             "FROM file, artist, track, file_join "
             "LEFT OUTER JOIN album "
             "ON file_join.album = album.id "
@@ -81,21 +127,47 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
             "WHERE file.id = file_join.file "
             "AND file_join.artist = artist.id "
             "AND file_join.track = track.id "
-            "%1 "
-            "%2 %3 "
-            "%4 %5 %6"
+            "%1 %2 "
+            "%3 %4 "
+            "%5 %6 %7"
             ).arg( sourceToken )
+             .arg( pageToken )
              .arg( !m_artist ? QString() : QString( "AND artist.id = %1" ).arg( m_artist->id() ) )
              .arg( !m_album ? QString() : albumToken )
-             .arg( m_sortOrder > 0 ? QString( "ORDER BY %1" ).arg( m_orderToken ) : QString() )
+             .arg( !m_orderToken.isEmpty() ? QString( "ORDER BY %1" ).arg( m_orderToken ) : QString() )
              .arg( m_sortDescending ? "DESC" : QString() )
-             .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
+             .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() )
+             .arg( m_sortOrder == Artist ? keyColumns.first() : QString( "NULL" ) );
 
     query.prepare( sql );
+    if ( !pageToken.isEmpty() )
+    {
+        int pos = 0;
+        for ( int i = 0; i < m_pageKey.count() - 1; i++ )
+        {
+            query.bindValue( pos++, m_pageKey.at( i ) );
+            query.bindValue( pos++, m_pageKey.at( i ) );
+        }
+        query.bindValue( pos, m_pageKey.last() );
+    }
     query.exec();
 
+    // where the next page starts, counting rows we skip below too
+    unsigned int rows = 0;
+    QVariantList lastKey;
+
     while( query.next() )
     {
+        rows++;
+        if ( m_sortOrder == Artist )
+        {
+            lastKey = QVariantList() << query.value( 18 ).toString() << query.value( 2 ).toString()
+                                     << qMax( 1, query.value( 12 ).toInt() ) << query.value( 13 ).toInt()
+                                     << query.value( 16 ).toUInt() << query.value( 0 ).toUInt();
+        }
+        else
+            lastKey = QVariantList() << query.value( 0 ).toUInt();
+
         Tomahawk::source_ptr s;
         QString url = query.value( 8 ).toString();
 
@@ -127,6 +199,7 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
         Tomahawk::artist_ptr composerptr = Tomahawk::Artist::get( query.value( 17 ).toUInt(), composer );
         Tomahawk::album_ptr albumptr = Tomahawk::Album::get( query.value( 15 ).toUInt(), album, artistptr );
 
+        result->setFileId( query.value( 0 ).toUInt() );
         result->setTrackId( query.value( 16 ).toUInt() );
         result->setArtist( artistptr );
         result->setAlbum( albumptr );
@@ -142,16 +215,16 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
         result->setScore( 1.0 );
         result->setCollection( s->collection() );
 
-        TomahawkSqlQuery attrQuery = dbi->newquery();
+        TomahawkSqlQuery attrQuery = dbi->preparedQuery( "SELECT k, v FROM track_attributes WHERE id = ?" );
         QVariantMap attr;
 
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
         attrQuery.bindValue( 0, result->trackId() );
         attrQuery.exec();
         while ( attrQuery.next() )
         {
             attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
         }
+        attrQuery.finish();
 
         result->setAttributes( attr );
 
@@ -166,5 +239,7 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
     qDebug() << Q_FUNC_INFO << ql.length();
 
     emit tracks( ql, data() );
+    if ( isPaged() )
+        emit page( ql, data(), rows < m_amount ? QVariantList() : lastKey );
     emit done( m_collection );
 }
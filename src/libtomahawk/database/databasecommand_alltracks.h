@@ -39,7 +39,8 @@ public:
         None = 0,
         Album = 1,
         ModificationTime = 2,
-        AlbumPosition = 3
+        AlbumPosition = 3,
+        Artist = 4 // like TrackProxyModel sorts by artist: artist sortname, album, disc & album position
     };
 
     explicit DatabaseCommand_AllTracks( const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr(), QObject* parent = 0 )
@@ -61,11 +62,16 @@ public:
     void setAlbum( const Tomahawk::album_ptr& album ) { m_album = album; }
 
     void setLimit( unsigned int amount ) { m_amount = amount; }
+    // keyset paging, for limited results without a sort order (ordered by file id then) or
+    // ascending by Artist. Pass the key page() emitted to get the next page
+    void setPageKey( const QVariantList& key ) { m_pageKey = key; }
     void setSortOrder( DatabaseCommand_AllTracks::SortOrder order ) { m_sortOrder = order; }
     void setSortDescending( bool descending ) { m_sortDescending = descending; }
 
 signals:
     void tracks( const QList<Tomahawk::query_ptr>&, const QVariant& data );
+    /// emitted along with tracks() when paging: nextKey continues after this page, it's empty if this was the last one
+    void page( const QList<Tomahawk::query_ptr>&, const QVariant& data, const QVariantList& nextKey );
     void done( const Tomahawk::collection_ptr& );
 
 private:
@@ -74,7 +80,10 @@ private:
     Tomahawk::artist_ptr m_artist;
     Tomahawk::album_ptr m_album;
 
+    bool isPaged() const;
+
     unsigned int m_amount;
+    QVariantList m_pageKey;
     DatabaseCommand_AllTracks::SortOrder m_sortOrder;
     bool m_sortDescending;
 };
@@ -31,6 +31,8 @@
 #include "utils/logger.h"
 #include "utils/tomahawkutils.h"
 
+#define ORPHAN_BATCH_SIZE 500
+
 using namespace Tomahawk;
 
 
@@ -41,6 +43,11 @@ DatabaseCommand_DeleteFiles::postCommitHook()
     if ( !m_idList.count() )
         return;
 
+    // only touch the index once the delete really happened, a rollback would leave it out of sync
+    if ( !m_orphanTracks.isEmpty() || !m_orphanAlbums.isEmpty() )
+        Database::instance()->impl()->m_fuzzyIndex->deleteFields( m_orphanTracks, m_orphanAlbums );
+    source()->updateIndexWhenSynced();
+
     // make the collection object emit its tracksAdded signal, so the
     // collection browser will update/fade in etc.
     Collection* coll = source()->collection().data();
@@ -89,6 +96,11 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
                 m_ids << dirquery.value( 0 );
                 m_idList << dirquery.value( 0 ).toUInt();
             }
+
+            dirquery.prepare( "DELETE FROM dirs_scanned WHERE name = ? OR name LIKE ?" );
+            dirquery.addBindValue( m_dir.canonicalPath() );
+            dirquery.addBindValue( m_dir.canonicalPath() + "/%" );
+            dirquery.exec();
         }
         else if ( !m_ids.isEmpty() )
         {
@@ -100,9 +112,16 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
 
     if ( m_deleteAll )
     {
+        collectIndexCandidates( dbi, QString( "IN ( SELECT id FROM file WHERE source %1 )" )
+                                        .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1" )
                     .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
         delquery.exec();
+
+        // the scanner must not skip any dir when re-adding the files
+        if ( source()->isLocal() )
+            delquery.exec( "DELETE FROM dirs_scanned" );
     }
     else if ( !m_ids.isEmpty() )
     {
@@ -127,6 +146,9 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
             idstring.chop( 2 ); //remove the trailing ", "
         }
 
+        if ( !idstring.isEmpty() )
+            collectIndexCandidates( dbi, QString( "IN ( %1 )" ).arg( idstring ) );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1 AND id IN ( %2 )" )
                              .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
                              .arg( idstring ) );
@@ -134,7 +156,58 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
     }
 
     if ( m_idList.count() )
-        source()->updateIndexWhenSynced();
+        collectOrphans( dbi );
 
     emit done( m_idList, source()->collection() );
 }
+
+
+void
+DatabaseCommand_DeleteFiles::collectIndexCandidates( DatabaseImpl* dbi, const QString& fileCondition )
+{
+    // remember which tracks & albums lose files, the ones left without any after
+    // the delete get dropped from the fuzzy index
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( QString( "SELECT DISTINCT track, album FROM file_join WHERE file %1" ).arg( fileCondition ) );
+    while ( query.next() )
+    {
+        m_trackIds << query.value( 0 ).toUInt();
+        if ( !query.value( 1 ).isNull() )
+            m_albumIds << query.value( 1 ).toUInt();
+    }
+}
+
+
+void
+DatabaseCommand_DeleteFiles::collectOrphans( DatabaseImpl* dbi )
+{
+    m_orphanTracks = orphans( dbi, "track", m_trackIds );
+    m_orphanAlbums = orphans( dbi, "album", m_albumIds );
+}
+
+
+QList< unsigned int >
+DatabaseCommand_DeleteFiles::orphans( DatabaseImpl* dbi, const QString& column, const QSet< unsigned int >& ids )
+{
+    // same rule as the full rebuild in DatabaseCommand_UpdateSearchIndex: only what still has a file is indexed.
+    // a batch of ids per query keeps the statement below sqlite's length limit when a whole collection goes
+    QList< unsigned int > result;
+    QList< unsigned int > candidates = ids.toList();
+
+    TomahawkSqlQuery query = dbi->newquery();
+    for ( int i = 0; i < candidates.count(); i += ORPHAN_BATCH_SIZE )
+    {
+        QStringList idstrings;
+        foreach ( unsigned int id, candidates.mid( i, ORPHAN_BATCH_SIZE ) )
+            idstrings << QString::number( id );
+
+        query.exec( QString( "SELECT id FROM %1 WHERE id IN ( %2 ) "
+                             "AND NOT EXISTS ( SELECT 1 FROM file_join, file WHERE file.id = file_join.file AND file_join.%1 = %1.id )" )
+                       .arg( column )
+                       .arg( idstrings.join( ", " ) ) );
+        while ( query.next() )
+            result << query.value( 0 ).toUInt();
+    }
+
+    return result;
+}
@@ -23,6 +23,7 @@
 #include <QtCore/QObject>
 #include <QtCore/QDir>
 #include <QtCore/QVariantMap>
+#include <QtCore/QSet>
 
 #include "database/databasecommandloggable.h"
 #include "typedefs.h"
@@ -79,10 +80,21 @@ signals:
     void notify( const QList<unsigned int>& ids );
 
 private:
+    void collectIndexCandidates( DatabaseImpl* dbi, const QString& fileCondition );
+    void collectOrphans( DatabaseImpl* dbi );
+    QList< unsigned int > orphans( DatabaseImpl* dbi, const QString& column, const QSet< unsigned int >& ids );
+
     QDir m_dir;
     QVariantList m_ids;
     QList<unsigned int> m_idList;
     bool m_deleteAll;
+
+    QSet<unsigned int> m_trackIds;
+    QSet<unsigned int> m_albumIds;
+
+    // left without any file, dropped from the fuzzy index once committed
+    QList<unsigned int> m_orphanTracks;
+    QList<unsigned int> m_orphanAlbums;
 };
 
 #endif // DATABASECOMMAND_DELETEFILES_H
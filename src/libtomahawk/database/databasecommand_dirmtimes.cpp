@@ -79,8 +79,9 @@ DatabaseCommand_DirMtimes::execUpdate( DatabaseImpl* dbi )
 {
     qDebug() << "Saving mtimes...";
     TomahawkSqlQuery query = dbi->newquery();
-    query.exec( "DELETE FROM dirs_scanned" );
-    query.prepare( "INSERT INTO dirs_scanned(name, mtime) VALUES(?, ?)" );
+    if ( m_replaceAll )
+        query.exec( "DELETE FROM dirs_scanned" );
+    query.prepare( "INSERT OR REPLACE INTO dirs_scanned(name, mtime) VALUES(?, ?)" );
 
     foreach( const QString& k, m_tosave.keys() )
     {
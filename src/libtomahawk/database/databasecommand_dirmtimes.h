@@ -37,15 +37,16 @@ Q_OBJECT
 
 public:
     explicit DatabaseCommand_DirMtimes( const QString& prefix = QString(), QObject* parent = 0 )
-        : DatabaseCommand( parent ), m_prefix( prefix ), m_update( false )
+        : DatabaseCommand( parent ), m_prefix( prefix ), m_update( false ), m_replaceAll( false )
     {}
 
     explicit DatabaseCommand_DirMtimes( const QStringList& prefixes, QObject* parent = 0 )
-    : DatabaseCommand( parent ), m_prefixes( prefixes ), m_update( false )
+    : DatabaseCommand( parent ), m_prefixes( prefixes ), m_update( false ), m_replaceAll( false )
     {}
 
-    explicit DatabaseCommand_DirMtimes( QMap<QString, unsigned int> tosave, QObject* parent = 0 )
-        : DatabaseCommand( parent ), m_update( true ), m_tosave( tosave )
+    /// replaceAll drops all previously saved dirs, otherwise only the given ones are updated
+    explicit DatabaseCommand_DirMtimes( QMap<QString, unsigned int> tosave, bool replaceAll = true, QObject* parent = 0 )
+        : DatabaseCommand( parent ), m_update( true ), m_replaceAll( replaceAll ), m_tosave( tosave )
     {}
 
     virtual void exec( DatabaseImpl* );
@@ -65,6 +66,7 @@ private:
     QString m_prefix;
     QStringList m_prefixes;
     bool m_update;
+    bool m_replaceAll;
     QMap<QString, unsigned int> m_tosave;
 };
 
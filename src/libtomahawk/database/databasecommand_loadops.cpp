@@ -51,8 +51,9 @@ DatabaseCommand_loadOps::exec( DatabaseImpl* dbi )
                    "FROM oplog "
                    "WHERE source %1 "
                    "AND id > coalesce((SELECT id FROM oplog WHERE guid = ?),0) "
-                   "ORDER BY id ASC"
+                   "ORDER BY id ASC %2"
                    ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
+                    .arg( m_limit > 0 ? QString( "LIMIT %1" ).arg( m_limit ) : QString() )
                   );
     query.addBindValue( m_since );
     query.exec();
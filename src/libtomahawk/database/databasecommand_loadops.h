@@ -30,8 +30,9 @@ class DLLEXPORT DatabaseCommand_loadOps : public DatabaseCommand
 {
 Q_OBJECT
 public:
-    explicit DatabaseCommand_loadOps( const Tomahawk::source_ptr& src, QString since, QObject* parent = 0 )
-        : DatabaseCommand( src ), m_since( since )
+    /// loads at most limit ops after since, or all of them if limit is 0
+    explicit DatabaseCommand_loadOps( const Tomahawk::source_ptr& src, QString since, int limit = 0, QObject* parent = 0 )
+        : DatabaseCommand( src ), m_since( since ), m_limit( limit )
     {
         Q_UNUSED( parent );
     }
@@ -45,6 +46,7 @@ signals:
 
 private:
     QString m_since; // guid to load from
+    int m_limit;
 };
 
 #endif // DATABASECOMMAND_LOADOPS_H
@@ -0,0 +1,65 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "databasecommand_loadresultids.h"
+
+#include "databaseimpl.h"
+#include "utils/logger.h"
+
+using namespace Tomahawk;
+
+
+DatabaseCommand_LoadResultIds::DatabaseCommand_LoadResultIds( const QID& qid, const QList< result_ptr >& results, QObject* parent )
+    : DatabaseCommand( parent )
+    , m_qid( qid )
+    , m_results( results )
+{
+    // copy the names now, the results might get changed while we wait in the queue
+    foreach ( const result_ptr& result, results )
+    {
+        m_names << QPair< QString, QString >( result->artist().isNull() ? QString() : result->artist()->name(),
+                                              result->album().isNull() ? QString() : result->album()->name() );
+    }
+}
+
+
+void
+DatabaseCommand_LoadResultIds::exec( DatabaseImpl* dbi )
+{
+    QList< artist_ptr > artists;
+    QList< album_ptr > albums;
+
+    QHash< QString, artist_ptr > artistCache;
+    for ( int i = 0; i < m_names.count(); i++ )
+    {
+        const QString& artistName = m_names.at( i ).first;
+        const QString& albumName = m_names.at( i ).second;
+
+        artist_ptr artist = artistCache.value( artistName );
+        if ( artist.isNull() )
+        {
+            artist = Artist::get( dbi->artistId( artistName, false ), artistName );
+            artistCache.insert( artistName, artist );
+        }
+
+        artists << artist;
+        albums << Album::get( dbi->albumId( artist->id(), albumName, false ), albumName, artist );
+    }
+
+    emit done( m_qid, m_results, artists, albums );
+}
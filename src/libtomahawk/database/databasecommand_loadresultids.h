@@ -0,0 +1,56 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASECOMMAND_LOADRESULTIDS_H
+#define DATABASECOMMAND_LOADRESULTIDS_H
+
+#include "databasecommand.h"
+#include "result.h"
+#include "artist.h"
+#include "album.h"
+
+#include "dllmacro.h"
+
+/**
+  Looks up the database artist & album of results reported by resolvers, which only know them
+  by name. The artists & albums are emitted in the same order as the results, it's up to the
+  receiver to set them, so results shared with other threads are never touched here.
+  Nothing is created, unknown artists & albums come back with an id of 0.
+  */
+class DLLEXPORT DatabaseCommand_LoadResultIds : public DatabaseCommand
+{
+Q_OBJECT
+
+public:
+    explicit DatabaseCommand_LoadResultIds( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results, QObject* parent = 0 );
+
+    virtual void exec( DatabaseImpl* );
+    virtual bool doesMutates() const { return false; }
+    virtual QString commandname() const { return "loadresultids"; }
+
+signals:
+    void done( const Tomahawk::QID& qid, const QList< Tomahawk::result_ptr >& results,
+               const QList< Tomahawk::artist_ptr >& artists, const QList< Tomahawk::album_ptr >& albums );
+
+private:
+    Tomahawk::QID m_qid;
+    QList< Tomahawk::result_ptr > m_results;
+    QList< QPair< QString, QString > > m_names;
+};
+
+#endif // DATABASECOMMAND_LOADRESULTIDS_H
@@ -35,27 +35,18 @@ DatabaseCommand_LoadSocialActions::exec( DatabaseImpl* dbi )
     qDebug() << Q_FUNC_INFO;
     Q_ASSERT( !source().isNull() );
 
+    // resolve the track by its sortnames in the same statement, the lookups go through
+    // the unique sortname indexes and social_attrib_id_timestamp already returns the rows in order
     TomahawkSqlQuery query = dbi->newquery();
-
-    QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
-
-    int artid = dbi->artistId( m_artist, false );
-    if( artid < 1 )
-        return;
-
-    int trkid = dbi->trackId( artid, m_track, false );
-    if( trkid < 1 )
-        return;
-
-    QString whereToken;
-    whereToken = QString( "WHERE id IS %1" ).arg( trkid );
-
-    QString sql = QString(
-            "SELECT k, v, timestamp, source "
-            "FROM social_attributes %1 "
-            "ORDER BY timestamp ASC" ).arg( whereToken );
-
-    query.prepare( sql );
+    query.prepare( "SELECT social_attributes.k, social_attributes.v, social_attributes.timestamp, social_attributes.source "
+                   "FROM artist, track, social_attributes "
+                   "WHERE artist.sortname = ? "
+                   "AND track.artist = artist.id "
+                   "AND track.sortname = ? "
+                   "AND social_attributes.id = track.id "
+                   "ORDER BY social_attributes.timestamp ASC" );
+    query.addBindValue( DatabaseImpl::sortname( m_artist ) );
+    query.addBindValue( DatabaseImpl::sortname( m_track ) );
     query.exec();
 
     QList< Tomahawk::SocialAction > allSocialActions;
@@ -81,9 +81,8 @@ DatabaseCommand_LogPlayback::exec( DatabaseImpl* dbi )
     if ( m_secsPlayed < FINISHED_THRESHOLD )
         return;
 
-    TomahawkSqlQuery query = dbi->newquery();
-    query.prepare( "INSERT INTO playback_log(source, track, playtime, secs_played) "
-                   "VALUES (?, ?, ?, ?)" );
+    TomahawkSqlQuery query = dbi->preparedQuery( "INSERT INTO playback_log(source, track, playtime, secs_played) "
+                                                 "VALUES (?, ?, ?, ?)" );
 
     QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
     qDebug() << "Logging playback of" << m_artist << "-" << m_track << "for source" << srcid;
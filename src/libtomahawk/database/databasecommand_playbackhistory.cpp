@@ -35,14 +35,17 @@ DatabaseCommand_PlaybackHistory::exec( DatabaseImpl* dbi )
     QString whereToken;
     if ( !source().isNull() )
     {
-        whereToken = QString( "WHERE source %1" ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
+        whereToken = QString( "AND playback_log.source %1" ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
     }
 
+    // walks the (source, playtime) / (playtime) index backwards and joins the names in, one statement for the whole page
     QString sql = QString(
-            "SELECT track, playtime, secs_played, source "
-            "FROM playback_log "
+            "SELECT track.name, artist.name, playback_log.playtime, playback_log.source "
+            "FROM playback_log, track, artist "
+            "WHERE track.id = playback_log.track "
+            "AND artist.id = track.artist "
             "%1 "
-            "ORDER BY playtime DESC "
+            "ORDER BY playback_log.playtime DESC "
             "%2" ).arg( whereToken )
                   .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
 
@@ -51,33 +54,18 @@ DatabaseCommand_PlaybackHistory::exec( DatabaseImpl* dbi )
 
     while( query.next() )
     {
-        TomahawkSqlQuery query_track = dbi->newquery();
+        Tomahawk::query_ptr q = Tomahawk::Query::get( query.value( 1 ).toString(), query.value( 0 ).toString(), QString() );
 
-        QString sql = QString(
-                "SELECT track.name, artist.name "
-                "FROM track, artist "
-                "WHERE artist.id = track.artist "
-                "AND track.id = %1"
-                ).arg( query.value( 0 ).toUInt() );
-
-        query_track.prepare( sql );
-        query_track.exec();
-
-        if ( query_track.next() )
+        if ( query.value( 3 ).toUInt() == 0 )
         {
-            Tomahawk::query_ptr q = Tomahawk::Query::get( query_track.value( 1 ).toString(), query_track.value( 0 ).toString(), QString() );
-
-            if ( query.value( 3 ).toUInt() == 0 )
-            {
-                q->setPlayedBy( SourceList::instance()->getLocal(), query.value( 1 ).toUInt() );
-            }
-            else
-            {
-                q->setPlayedBy( SourceList::instance()->get( query.value( 3 ).toUInt() ), query.value( 1 ).toUInt() );
-            }
-
-            ql << q;
+            q->setPlayedBy( SourceList::instance()->getLocal(), query.value( 2 ).toUInt() );
         }
+        else
+        {
+            q->setPlayedBy( SourceList::instance()->get( query.value( 3 ).toUInt() ), query.value( 2 ).toUInt() );
+        }
+
+        ql << q;
     }
 
     if ( ql.count() )
@@ -24,6 +24,9 @@
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// full-text queries match broadly, only the best candidates get looked up
+#define MAX_FULLTEXT_CANDIDATES 250
+
 using namespace Tomahawk;
 
 
@@ -88,104 +91,13 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
     }
 
     // STEP 2
-    TomahawkSqlQuery files_query = lib->newquery();
-
-    QStringList trksl;
-    for ( int k = 0; k < tracks.count(); k++ )
-        trksl.append( QString::number( tracks.at( k ).first ) );
-
-    QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
-
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid "                                 //20
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "(%1)" )
-         .arg( trksToken );
-
-    files_query.prepare( sql );
-    files_query.exec();
-
-    while ( files_query.next() )
-    {
-        source_ptr s;
-        QString url = files_query.value( 0 ).toString();
-
-        if ( files_query.value( 16 ).toUInt() == 0 )
-        {
-            s = SourceList::instance()->getLocal();
-        }
-        else
-        {
-            s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-            if ( s.isNull() )
-            {
-                qDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-                continue;
-            }
-
-            url = QString( "servent://%1\t%2" ).arg( s->userName() ).arg( url );
-        }
-
-        bool cached = Tomahawk::Result::isCached( url );
-        Tomahawk::result_ptr result = Tomahawk::Result::get( url );
-        if ( cached )
-        {
-            qDebug() << "Result already cached:" << result->toString();
-            res << result;
-            continue;
-        }
-
-        Tomahawk::artist_ptr artist = Tomahawk::Artist::get( files_query.value( 18 ).toUInt(), files_query.value( 12 ).toString() );
-        Tomahawk::album_ptr album = Tomahawk::Album::get( files_query.value( 19 ).toUInt(), files_query.value( 13 ).toString(), artist );
-        Tomahawk::artist_ptr composer = Tomahawk::Artist::get( files_query.value( 20 ).toUInt(), files_query.value( 15 ).toString() );
-
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setDuration( files_query.value( 5 ).toUInt() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setArtist( artist );
-        result->setComposer( composer );
-        result->setAlbum( album );
-        result->setDiscNumber( files_query.value( 11 ).toUInt() );
-        result->setTrack( files_query.value( 14 ).toString() );
-        result->setRID( uuid() );
-        result->setAlbumPos( files_query.value( 17 ).toUInt() );
-        result->setTrackId( files_query.value( 9 ).toUInt() );
-
-        TomahawkSqlQuery attrQuery = lib->newquery();
-        QVariantMap attr;
-
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
-        attrQuery.bindValue( 0, result->trackId() );
-        attrQuery.exec();
-        while ( attrQuery.next() )
-        {
-            attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
-        }
+    QList< int > trackIds;
+    foreach ( const scorepair_t& pair, tracks )
+        trackIds << pair.first;
 
-        result->setAttributes( attr );
-        result->setCollection( s->collection() );
-
-        res << result;
-    }
+    const QHash< unsigned int, QList< Tomahawk::result_ptr > > files = lib->tracksResults( trackIds );
+    foreach ( int trackId, trackIds )
+        res << files.value( trackId );
 
     emit results( m_query->id(), res );
 }
@@ -198,7 +110,7 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
     typedef QPair<int, float> scorepair_t;
 
     // STEP 1
-    QList< QPair<int, float> > trackPairs = lib->search( m_query );
+    QList< QPair<int, float> > trackPairs = lib->search( m_query, MAX_FULLTEXT_CANDIDATES );
     QList< QPair<int, float> > albumPairs = lib->searchAlbum( m_query, 20 );
 
     foreach ( const scorepair_t& albumPair, albumPairs )
@@ -228,111 +140,18 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
     }
 
     // STEP 2
-    TomahawkSqlQuery files_query = lib->newquery();
-
-    QStringList trksl;
-    for ( int k = 0; k < trackPairs.count(); k++ )
-        trksl.append( QString::number( trackPairs.at( k ).first ) );
+    QList< int > trackIds;
+    foreach ( const scorepair_t& pair, trackPairs )
+        trackIds << pair.first;
 
-    QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid "                                 //20
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "%1" )
-                        .arg( trksl.length() > 0 ? trksToken : QString( "0" ) );
-
-    files_query.prepare( sql );
-    files_query.exec();
-
-    while ( files_query.next() )
+    const QHash< unsigned int, QList< Tomahawk::result_ptr > > files = lib->tracksResults( trackIds );
+    foreach ( const scorepair_t& pair, trackPairs )
     {
-        source_ptr s;
-        QString url = files_query.value( 0 ).toString();
-
-        if ( files_query.value( 16 ).toUInt() == 0 )
-        {
-            s = SourceList::instance()->getLocal();
-        }
-        else
-        {
-            s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-            if ( s.isNull() )
-            {
-                qDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-                continue;
-            }
-
-            url = QString( "servent://%1\t%2" ).arg( s->userName() ).arg( url );
-        }
-
-        bool cached = Tomahawk::Result::isCached( url );
-        Tomahawk::result_ptr result = Tomahawk::Result::get( url );
-        if ( cached )
+        foreach ( const Tomahawk::result_ptr& result, files.value( pair.first ) )
         {
-            qDebug() << "Result already cached:" << result->toString();
+            result->setScore( pair.second );
             res << result;
-            continue;
         }
-
-        Tomahawk::artist_ptr artist = Tomahawk::Artist::get( files_query.value( 18 ).toUInt(), files_query.value( 12 ).toString() );
-        Tomahawk::album_ptr album = Tomahawk::Album::get( files_query.value( 19 ).toUInt(), files_query.value( 13 ).toString(), artist );
-        Tomahawk::artist_ptr composer = Tomahawk::Artist::get( files_query.value( 20 ).toUInt(), files_query.value( 15 ).toString() );
-
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setDuration( files_query.value( 5 ).toUInt() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setArtist( artist );
-        result->setComposer( composer );
-        result->setAlbum( album );
-        result->setDiscNumber( files_query.value( 11 ).toUInt() );
-        result->setTrack( files_query.value( 14 ).toString() );
-        result->setRID( uuid() );
-        result->setAlbumPos( files_query.value( 17 ).toUInt() );
-        result->setTrackId( files_query.value( 9 ).toUInt() );
-
-        for ( int k = 0; k < trackPairs.count(); k++ )
-        {
-            if ( trackPairs.at( k ).first == (int)result->trackId() )
-            {
-                result->setScore( trackPairs.at( k ).second );
-                break;
-            }
-        }
-
-        TomahawkSqlQuery attrQuery = lib->newquery();
-        QVariantMap attr;
-
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
-        attrQuery.bindValue( 0, result->trackId() );
-        attrQuery.exec();
-        while ( attrQuery.next() )
-        {
-            attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
-        }
-
-        result->setAttributes( attr );
-        result->setCollection( s->collection() );
-
-        res << result;
     }
 
     emit results( m_query->id(), res );
@@ -0,0 +1,108 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "databasecommand_resolvebatch.h"
+
+#include <QSet>
+
+#include "pipeline.h"
+#include "sourcelist.h"
+#include "utils/logger.h"
+
+using namespace Tomahawk;
+
+
+DatabaseCommand_ResolveBatch::DatabaseCommand_ResolveBatch( const QList< query_ptr >& queries )
+    : DatabaseCommand()
+    , m_queries( queries )
+{
+    Q_ASSERT( Pipeline::instance()->isRunning() );
+}
+
+
+DatabaseCommand_ResolveBatch::~DatabaseCommand_ResolveBatch()
+{
+}
+
+
+void
+DatabaseCommand_ResolveBatch::exec( DatabaseImpl* lib )
+{
+    /*
+     *        Same two stages as DatabaseCommand_Resolve, but for all queries at once:
+     *        1) find the candidate track IDs for every query in the fuzzy index
+     *        2) fetch the files (and their attributes) of all candidates together
+     */
+
+    QList< query_ptr > queries;
+    foreach ( const query_ptr& query, m_queries )
+    {
+        Q_ASSERT( !query->isFullTextQuery() );
+
+        if ( !query->resultHint().isEmpty() )
+        {
+            Tomahawk::result_ptr result = lib->resultFromHint( query );
+            if ( !result.isNull() && !result->collection().isNull() && result->collection()->source()->isOnline() )
+            {
+                QList<Tomahawk::result_ptr> res;
+                res << result;
+                emit results( query->id(), res );
+                continue;
+            }
+        }
+
+        queries << query;
+    }
+
+    // STEP 1
+    QList< QList< int > > candidates;
+    QList< int > trackIds;
+    QSet< int > seen;
+    foreach ( const query_ptr& query, queries )
+    {
+        QList< int > tracks;
+        typedef QPair<int, float> scorepair_t;
+        foreach ( const scorepair_t& pair, lib->search( query ) )
+        {
+            tracks << pair.first;
+            if ( !seen.contains( pair.first ) )
+            {
+                seen << pair.first;
+                trackIds << pair.first;
+            }
+        }
+
+        candidates << tracks;
+    }
+
+    // STEP 2
+    QHash< unsigned int, QList< Tomahawk::result_ptr > > files;
+    if ( !trackIds.isEmpty() )
+        files = lib->tracksResults( trackIds );
+
+    for ( int i = 0; i < queries.count(); i++ )
+    {
+        QList<Tomahawk::result_ptr> res;
+        foreach ( int trackId, candidates.at( i ) )
+            res << files.value( trackId );
+
+        emit results( queries.at( i )->id(), res );
+    }
+}
+
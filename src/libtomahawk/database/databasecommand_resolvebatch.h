@@ -0,0 +1,57 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DATABASECOMMAND_RESOLVEBATCH_H
+#define DATABASECOMMAND_RESOLVEBATCH_H
+
+#include "databasecommand.h"
+#include "databaseimpl.h"
+#include "result.h"
+
+#include <QVariant>
+
+#include "dllmacro.h"
+
+/**
+ * Resolves many (non full-text) queries at once. Fuzzy searches are still run
+ * per query, but all candidate files and their attributes are fetched with a
+ * handful of set-based queries. Results are emitted per QID.
+ */
+class DLLEXPORT DatabaseCommand_ResolveBatch : public DatabaseCommand
+{
+Q_OBJECT
+public:
+    explicit DatabaseCommand_ResolveBatch( const QList< Tomahawk::query_ptr >& queries );
+    virtual ~DatabaseCommand_ResolveBatch();
+
+    virtual QString commandname() const { return "dbresolvebatch"; }
+    virtual bool doesMutates() const { return false; }
+
+    virtual void exec( DatabaseImpl *lib );
+
+signals:
+    void results( Tomahawk::QID qid, QList<Tomahawk::result_ptr> results );
+
+private:
+    DatabaseCommand_ResolveBatch();
+
+    QList< Tomahawk::query_ptr > m_queries;
+};
+
+#endif // DATABASECOMMAND_RESOLVEBATCH_H
@@ -0,0 +1,70 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "databasecommand_topplayed.h"
+
+#include <QSqlQuery>
+
+#include "databaseimpl.h"
+#include "sourcelist.h"
+
+#include "utils/logger.h"
+
+
+void
+DatabaseCommand_TopPlayed::exec( DatabaseImpl* dbi )
+{
+    TomahawkSqlQuery query = dbi->newquery();
+    QList<Tomahawk::query_ptr> ql;
+    QVariantList counts;
+
+    QStringList conditions;
+    if ( !source().isNull() )
+        conditions << QString( "source %1" ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
+    if ( m_since > 0 )
+        conditions << QString( "playtime >= %1" ).arg( m_since );
+
+    // the counting only touches the playback_log indexes (track, or source/playtime + track),
+    // names are joined in for the few rows that make it past the LIMIT
+    QString sql = QString(
+            "SELECT track.name, artist.name, top.counter "
+            "FROM ( SELECT track AS tid, COUNT(*) AS counter "
+                   "FROM playback_log "
+                   "%1 "
+                   "GROUP BY track "
+                   "ORDER BY counter DESC "
+                   "%2 ) AS top, track, artist "
+            "WHERE track.id = top.tid "
+            "AND artist.id = track.artist "
+            "ORDER BY top.counter DESC" )
+            .arg( conditions.isEmpty() ? QString() : "WHERE " + conditions.join( " AND " ) )
+            .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
+
+    query.prepare( sql );
+    query.exec();
+
+    while ( query.next() )
+    {
+        ql << Tomahawk::Query::get( query.value( 1 ).toString(), query.value( 0 ).toString(), QString() );
+        counts << query.value( 2 );
+    }
+
+    if ( ql.count() )
+        emit tracks( ql, counts );
+}
@@ -0,0 +1,64 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DATABASECOMMAND_TOPPLAYED_H
+#define DATABASECOMMAND_TOPPLAYED_H
+
+#include <QObject>
+#include <QVariantMap>
+
+#include "databasecommand.h"
+#include "typedefs.h"
+
+#include "dllmacro.h"
+
+/**
+ * Counts plays per track in the playback log and returns the most played tracks,
+ * most played first. Optionally restricted to one source and to plays since a given time.
+ */
+class DLLEXPORT DatabaseCommand_TopPlayed : public DatabaseCommand
+{
+Q_OBJECT
+public:
+    explicit DatabaseCommand_TopPlayed( const Tomahawk::source_ptr& source = Tomahawk::source_ptr(), QObject* parent = 0 )
+        : DatabaseCommand( parent )
+        , m_amount( 0 )
+        , m_since( 0 )
+    {
+        setSource( source );
+    }
+
+    virtual void exec( DatabaseImpl* );
+
+    virtual bool doesMutates() const { return false; }
+    virtual QString commandname() const { return "topplayed"; }
+
+    void setLimit( unsigned int amount ) { m_amount = amount; }
+    // only count plays that happened at or after this timestamp
+    void setSince( unsigned int timestamp ) { m_since = timestamp; }
+
+signals:
+    void tracks( const QList<Tomahawk::query_ptr>& queries, const QVariantList& playCounts );
+
+private:
+    unsigned int m_amount;
+    unsigned int m_since;
+};
+
+#endif // DATABASECOMMAND_TOPPLAYED_H
@@ -53,7 +53,9 @@ DatabaseCommand_UpdateSearchIndex::exec( DatabaseImpl* db )
     QMap< unsigned int, QMap< QString, QString > > data;
     TomahawkSqlQuery q = db->newquery();
 
-    q.exec( "SELECT track.id, track.name, artist.name, artist.id FROM track, artist WHERE artist.id = track.artist" );
+    // only tracks & albums that still have a file get indexed, DatabaseCommand_DeleteFiles drops the others by the same rule
+    q.exec( "SELECT track.id, track.name, artist.name, artist.id FROM track, artist WHERE artist.id = track.artist "
+            "AND EXISTS ( SELECT 1 FROM file_join, file WHERE file.id = file_join.file AND file_join.track = track.id )" );
     while ( q.next() )
     {
         QMap< QString, QString > track;
@@ -67,7 +69,8 @@ DatabaseCommand_UpdateSearchIndex::exec( DatabaseImpl* db )
     db->m_fuzzyIndex->appendFields( data );
     data.clear();
 
-    q.exec( "SELECT album.id, album.name FROM album" );
+    q.exec( "SELECT album.id, album.name FROM album "
+            "WHERE EXISTS ( SELECT 1 FROM file_join, file WHERE file.id = file_join.file AND file_join.album = album.id )" );
     while ( q.next() )
     {
         QMap< QString, QString > album;
@@ -78,6 +81,10 @@ DatabaseCommand_UpdateSearchIndex::exec( DatabaseImpl* db )
 
     db->m_fuzzyIndex->appendFields( data );
 
+    q.prepare( "INSERT OR REPLACE INTO settings(k, v) VALUES('fuzzyindex_version', ?)" );
+    q.addBindValue( FUZZYINDEX_VERSION );
+    q.exec();
+
     qDebug() << "Building index finished.";
 
     db->m_fuzzyIndex->endIndexing();
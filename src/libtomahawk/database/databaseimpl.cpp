@@ -25,6 +25,7 @@
 #include <QStringList>
 #include <QtAlgorithms>
 #include <QFile>
+#include <QSet>
 
 #include "database/database.h"
 #include "databasecommand_updatesearchindex.h"
@@ -41,11 +42,19 @@
 */
 #include "schema.sql.h"
 
-#define CURRENT_SCHEMA_VERSION 28
+#define CURRENT_SCHEMA_VERSION 30
+
+// how long a connection waits for another connection's write lock before giving up (ms)
+#define DATABASE_BUSY_TIMEOUT 5000
+
+// upper bound for the number of ids we inline into a single IN ( ... ) clause
+#define MAX_IDS_PER_QUERY 500
 
 
 DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
     : QObject( (QObject*) parent )
+    , m_dbname( dbname )
+    , m_threadDbCount( 0 )
     , m_lastartid( 0 )
     , m_lastalbid( 0 )
     , m_lasttrkid( 0 )
@@ -74,13 +83,29 @@ DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
     query.exec( "PRAGMA synchronous  = ON" );
     query.exec( "PRAGMA foreign_keys = ON" );
     //query.exec( "PRAGMA temp_store = MEMORY" );
+
+    // write-ahead logging lets the per-worker reader connections see a consistent
+    // snapshot while the rw worker commits, instead of waiting for its lock
+    query.exec( "PRAGMA journal_mode = WAL" );
+    if ( query.next() )
+        tDebug( LOGVERBOSE ) << "Database journal mode:" << query.value( 0 ).toString();
     tDebug( LOGVERBOSE ) << "Tweaked db pragmas:" << t.elapsed();
 
     // in case of unclean shutdown last time:
     query.exec( "UPDATE source SET isonline = 'false'" );
 
-    m_fuzzyIndex = new FuzzyIndex( *this, schemaUpdated );
-    if ( schemaUpdated )
+    // the index is kept up to date incrementally, so it only needs a full rebuild
+    // when the schema or the index layout itself changed
+    bool rebuildIndex = schemaUpdated;
+    query.exec( "SELECT v FROM settings WHERE k='fuzzyindex_version'" );
+    if ( !query.next() || query.value( 0 ).toInt() != FUZZYINDEX_VERSION )
+    {
+        tLog() << "Fuzzy index is outdated, rebuilding";
+        rebuildIndex = true;
+    }
+
+    m_fuzzyIndex = new FuzzyIndex( *this, rebuildIndex );
+    if ( rebuildIndex )
         QTimer::singleShot( 0, this, SLOT( updateIndex() ) );
 
     tDebug( LOGVERBOSE ) << "Loaded index:" << t.elapsed();
@@ -99,6 +124,94 @@ DatabaseImpl::~DatabaseImpl()
 }
 
 
+void
+DatabaseImpl::attachThread()
+{
+    if ( m_threadDb.hasLocalData() && m_threadDb.localData() )
+        return;
+
+    const QString name = QString( "tomahawk_%1" ).arg( m_threadDbCount.fetchAndAddOrdered( 1 ) );
+    QSqlDatabase* db = new QSqlDatabase( QSqlDatabase::addDatabase( "QSQLITE", name ) );
+    db->setDatabaseName( m_dbname );
+    db->setConnectOptions( QString( "QSQLITE_BUSY_TIMEOUT=%1" ).arg( DATABASE_BUSY_TIMEOUT ) );
+    if ( !db->open() )
+    {
+        tLog() << "Failed to open thread connection" << name << "to database" << m_dbname;
+        delete db;
+        QSqlDatabase::removeDatabase( name );
+        return;
+    }
+
+    // connection-local pragmas, journal_mode is persisted in the file itself
+    QSqlQuery query( *db );
+    query.exec( "PRAGMA synchronous  = ON" );
+    query.exec( "PRAGMA foreign_keys = ON" );
+
+    m_threadDb.setLocalData( db );
+    tDebug( LOGVERBOSE ) << "Opened database connection" << name << "for thread" << QThread::currentThread();
+}
+
+
+void
+DatabaseImpl::detachThread()
+{
+    if ( !m_threadDb.hasLocalData() || !m_threadDb.localData() )
+        return;
+
+    // prepared statements must be gone before their connection is
+    m_preparedQueries.setLocalData( 0 );
+
+    const QString name = m_threadDb.localData()->connectionName();
+    m_threadDb.localData()->close();
+
+    // QThreadStorage deletes the previous QSqlDatabase handle for us, which
+    // has to happen before the connection can be removed
+    m_threadDb.setLocalData( 0 );
+    QSqlDatabase::removeDatabase( name );
+}
+
+
+QSqlDatabase&
+DatabaseImpl::database()
+{
+    if ( m_threadDb.hasLocalData() )
+    {
+        QSqlDatabase* db = m_threadDb.localData();
+        if ( db )
+            return *db;
+    }
+
+    return m_db;
+}
+
+
+TomahawkSqlQuery
+DatabaseImpl::preparedQuery( const QString& sql )
+{
+    // the shared connection might be used by several threads, don't keep statements for it
+    if ( !m_threadDb.hasLocalData() || !m_threadDb.localData() )
+    {
+        TomahawkSqlQuery query = newquery();
+        query.prepare( sql );
+        return query;
+    }
+
+    if ( !m_preparedQueries.hasLocalData() )
+        m_preparedQueries.setLocalData( new QHash< QString, TomahawkSqlQuery >() );
+
+    QHash< QString, TomahawkSqlQuery >* queries = m_preparedQueries.localData();
+    QHash< QString, TomahawkSqlQuery >::iterator it = queries->find( sql );
+    if ( it == queries->end() )
+    {
+        TomahawkSqlQuery query = newquery();
+        query.prepare( sql );
+        it = queries->insert( sql, query );
+    }
+
+    return it.value();
+}
+
+
 void
 DatabaseImpl::dumpDatabase()
 {
@@ -266,25 +379,151 @@ DatabaseImpl::file( int fid )
 }
 
 
+QHash< unsigned int, QList< Tomahawk::result_ptr > >
+DatabaseImpl::tracksResults( const QList< int >& trackIds )
+{
+    QHash< unsigned int, QList< Tomahawk::result_ptr > > files;
+    QSet< int > newTrackIds;
+    QList< Tomahawk::result_ptr > newResults;
+
+    for ( int offset = 0; offset < trackIds.count(); offset += MAX_IDS_PER_QUERY )
+    {
+        QStringList trksl;
+        foreach ( int id, trackIds.mid( offset, MAX_IDS_PER_QUERY ) )
+            trksl.append( QString::number( id ) );
+
+        TomahawkSqlQuery files_query = newquery();
+        QString sql = QString( "SELECT "
+                                "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
+                                "file_join.artist, file_join.album, file_join.track, "  //7
+                                "file_join.composer, file_join.discnumber, "            //10
+                                "artist.name as artname, "                              //12
+                                "album.name as albname, "                               //13
+                                "track.name as trkname, "                               //14
+                                "composer.name as cmpname, "                            //15
+                                "file.source, "                                         //16
+                                "file_join.albumpos, "                                  //17
+                                "artist.id as artid, "                                  //18
+                                "album.id as albid, "                                   //19
+                                "composer.id as cmpid "                                 //20
+                                "FROM file, file_join, artist, track "
+                                "LEFT JOIN album ON album.id = file_join.album "
+                                "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
+                                "WHERE "
+                                "artist.id = file_join.artist AND "
+                                "track.id = file_join.track AND "
+                                "file.id = file_join.file AND "
+                                "file_join.track IN (%1)" )
+                             .arg( trksl.join( "," ) );
+
+        files_query.prepare( sql );
+        files_query.exec();
+
+        while ( files_query.next() )
+        {
+            Tomahawk::source_ptr s;
+            QString url = files_query.value( 0 ).toString();
+            const unsigned int trackId = files_query.value( 9 ).toUInt();
+
+            if ( files_query.value( 16 ).toUInt() == 0 )
+            {
+                s = SourceList::instance()->getLocal();
+            }
+            else
+            {
+                s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
+                if ( s.isNull() )
+                {
+                    qDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
+                    continue;
+                }
+
+                url = QString( "servent://%1\t%2" ).arg( s->userName() ).arg( url );
+            }
+
+            bool cached = Tomahawk::Result::isCached( url );
+            Tomahawk::result_ptr result = Tomahawk::Result::get( url );
+            files[ trackId ] << result;
+            if ( cached )
+                continue;
+
+            Tomahawk::artist_ptr artist = Tomahawk::Artist::get( files_query.value( 18 ).toUInt(), files_query.value( 12 ).toString() );
+            Tomahawk::album_ptr album = Tomahawk::Album::get( files_query.value( 19 ).toUInt(), files_query.value( 13 ).toString(), artist );
+            Tomahawk::artist_ptr composer = Tomahawk::Artist::get( files_query.value( 20 ).toUInt(), files_query.value( 15 ).toString() );
+
+            result->setModificationTime( files_query.value( 1 ).toUInt() );
+            result->setSize( files_query.value( 2 ).toUInt() );
+            result->setMimetype( files_query.value( 4 ).toString() );
+            result->setDuration( files_query.value( 5 ).toUInt() );
+            result->setBitrate( files_query.value( 6 ).toUInt() );
+            result->setArtist( artist );
+            result->setComposer( composer );
+            result->setAlbum( album );
+            result->setDiscNumber( files_query.value( 11 ).toUInt() );
+            result->setTrack( files_query.value( 14 ).toString() );
+            result->setRID( uuid() );
+            result->setAlbumPos( files_query.value( 17 ).toUInt() );
+            result->setTrackId( trackId );
+            result->setCollection( s->collection() );
+
+            newTrackIds << trackId;
+            newResults << result;
+        }
+    }
+
+    loadTrackAttributes( newTrackIds.toList(), newResults );
+    return files;
+}
+
+
+void
+DatabaseImpl::loadTrackAttributes( const QList< int >& trackIds, const QList< Tomahawk::result_ptr >& results )
+{
+    QHash< unsigned int, QVariantMap > attributes;
+
+    for ( int offset = 0; offset < trackIds.count(); offset += MAX_IDS_PER_QUERY )
+    {
+        QStringList trksl;
+        foreach ( int id, trackIds.mid( offset, MAX_IDS_PER_QUERY ) )
+            trksl.append( QString::number( id ) );
+
+        TomahawkSqlQuery attrQuery = newquery();
+        attrQuery.prepare( QString( "SELECT id, k, v FROM track_attributes WHERE id IN (%1)" ).arg( trksl.join( "," ) ) );
+        attrQuery.exec();
+        while ( attrQuery.next() )
+        {
+            attributes[ attrQuery.value( 0 ).toUInt() ][ attrQuery.value( 1 ).toString() ] = attrQuery.value( 2 ).toString();
+        }
+    }
+
+    foreach ( const Tomahawk::result_ptr& result, results )
+        result->setAttributes( attributes.value( result->trackId() ) );
+}
+
+
 int
 DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
 {
-    if ( m_lastart == name_orig )
-        return m_lastartid;
+    {
+        QMutexLocker lock( &m_lastMutex );
+        if ( m_lastart == name_orig )
+            return m_lastartid;
+    }
 
     int id = 0;
     QString sortname = DatabaseImpl::sortname( name_orig );
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM artist WHERE sortname = ?" );
-    query.addBindValue( sortname );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM artist WHERE sortname = ?" );
+    query.bindValue( 0, sortname );
     query.exec();
     if ( query.next() )
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
+        QMutexLocker lock( &m_lastMutex );
         m_lastart = name_orig;
         m_lastartid = id;
         return id;
@@ -293,9 +532,9 @@ DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO artist(id,name,sortname) VALUES(NULL,?,?)" );
-        query.addBindValue( name_orig );
-        query.addBindValue( sortname );
+        query = preparedQuery( "INSERT INTO artist(id,name,sortname) VALUES(NULL,?,?)" );
+        query.bindValue( 0, name_orig );
+        query.bindValue( 1, sortname );
         if ( !query.exec() )
         {
             tDebug() << "Failed to insert artist:" << name_orig;
@@ -303,6 +542,8 @@ DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
         }
 
         id = query.lastInsertId().toInt();
+
+        QMutexLocker lock( &m_lastMutex );
         m_lastart = name_orig;
         m_lastartid = id;
     }
@@ -318,16 +559,16 @@ DatabaseImpl::trackId( int artistid, const QString& name_orig, bool autoCreate )
     QString sortname = DatabaseImpl::sortname( name_orig );
     //if( ( id = m_artistcache[sortname] ) ) return id;
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM track WHERE artist = ? AND sortname = ?" );
-    query.addBindValue( artistid );
-    query.addBindValue( sortname );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM track WHERE artist = ? AND sortname = ?" );
+    query.bindValue( 0, artistid );
+    query.bindValue( 1, sortname );
     query.exec();
 
     if ( query.next() )
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
         //m_trackcache[sortname]=id;
@@ -337,10 +578,10 @@ DatabaseImpl::trackId( int artistid, const QString& name_orig, bool autoCreate )
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO track(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
-        query.addBindValue( artistid );
-        query.addBindValue( name_orig );
-        query.addBindValue( sortname );
+        query = preparedQuery( "INSERT INTO track(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
+        query.bindValue( 0, artistid );
+        query.bindValue( 1, name_orig );
+        query.bindValue( 2, sortname );
         if ( !query.exec() )
         {
             tDebug() << "Failed to insert track:" << name_orig;
@@ -363,24 +604,28 @@ DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
         return 0;
     }
 
-    if ( m_lastartid == artistid && m_lastalb == name_orig )
-        return m_lastalbid;
+    {
+        QMutexLocker lock( &m_lastMutex );
+        if ( m_lastartid == artistid && m_lastalb == name_orig )
+            return m_lastalbid;
+    }
 
     int id = 0;
     QString sortname = DatabaseImpl::sortname( name_orig );
     //if( ( id = m_albumcache[sortname] ) ) return id;
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM album WHERE artist = ? AND sortname = ?" );
-    query.addBindValue( artistid );
-    query.addBindValue( sortname );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM album WHERE artist = ? AND sortname = ?" );
+    query.bindValue( 0, artistid );
+    query.bindValue( 1, sortname );
     query.exec();
     if ( query.next() )
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
+        QMutexLocker lock( &m_lastMutex );
         m_lastalb = name_orig;
         m_lastalbid = id;
         return id;
@@ -389,10 +634,10 @@ DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO album(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
-        query.addBindValue( artistid );
-        query.addBindValue( name_orig );
-        query.addBindValue( sortname );
+        query = preparedQuery( "INSERT INTO album(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
+        query.bindValue( 0, artistid );
+        query.bindValue( 1, name_orig );
+        query.bindValue( 2, sortname );
         if( !query.exec() )
         {
             tDebug() << "Failed to insert album:" << name_orig;
@@ -400,6 +645,8 @@ DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
         }
 
         id = query.lastInsertId().toInt();
+
+        QMutexLocker lock( &m_lastMutex );
         m_lastalb = name_orig;
         m_lastalbid = id;
     }
@@ -411,50 +658,14 @@ DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
 QList< QPair<int, float> >
 DatabaseImpl::search( const Tomahawk::query_ptr& query, uint limit )
 {
-    QList< QPair<int, float> > resultslist;
-
-    QMap< int, float > resultsmap = m_fuzzyIndex->search( query );
-    foreach ( int i, resultsmap.keys() )
-    {
-        resultslist << QPair<int, float>( i, (float)resultsmap.value( i ) );
-    }
-    qSort( resultslist.begin(), resultslist.end(), DatabaseImpl::scorepairSorter );
-
-    if ( !limit )
-        return resultslist;
-
-    QList< QPair<int, float> > resultscapped;
-    for ( int i = 0; i < (int)limit && i < resultsmap.count(); i++ )
-    {
-        resultscapped << resultslist.at( i );
-    }
-
-    return resultscapped;
+    return m_fuzzyIndex->search( query, limit );
 }
 
 
 QList< QPair<int, float> >
 DatabaseImpl::searchAlbum( const Tomahawk::query_ptr& query, uint limit )
 {
-    QList< QPair<int, float> > resultslist;
-
-    QMap< int, float > resultsmap = m_fuzzyIndex->searchAlbum( query );
-    foreach ( int i, resultsmap.keys() )
-    {
-        resultslist << QPair<int, float>( i, (float)resultsmap.value( i ) );
-    }
-    qSort( resultslist.begin(), resultslist.end(), DatabaseImpl::scorepairSorter );
-
-    if ( !limit )
-        return resultslist;
-
-    QList< QPair<int, float> > resultscapped;
-    for ( int i = 0; i < (int)limit && i < resultsmap.count(); i++ )
-    {
-        resultscapped << resultslist.at( i );
-    }
-
-    return resultscapped;
+    return m_fuzzyIndex->searchAlbum( query, limit );
 }
 
 
@@ -479,7 +690,17 @@ DatabaseImpl::getTrackFids( int tid )
 QString
 DatabaseImpl::sortname( const QString& str, bool replaceArticle )
 {
-    QString s = str.toLower().trimmed().replace( QRegExp( "[\\s]{2,}" ), " " );
+    QString s = str.toLower().trimmed();
+
+    // most names don't need the regexp, and it is by far the most expensive part
+    for ( int i = 1; i < s.length(); i++ )
+    {
+        if ( s.at( i ).isSpace() && s.at( i - 1 ).isSpace() )
+        {
+            s.replace( QRegExp( "[\\s]{2,}" ), " " );
+            break;
+        }
+    }
 
     if ( replaceArticle && s.startsWith( "the " ) )
     {
@@ -672,6 +893,7 @@ DatabaseImpl::openDatabase( const QString& dbname )
     {
         QSqlDatabase db = QSqlDatabase::addDatabase( "QSQLITE", "tomahawk" );
         db.setDatabaseName( dbname );
+        db.setConnectOptions( QString( "QSQLITE_BUSY_TIMEOUT=%1" ).arg( DATABASE_BUSY_TIMEOUT ) );
         if ( !db.open() )
         {
             tLog() << "Failed to open database" << dbname;
@@ -705,6 +927,7 @@ DatabaseImpl::openDatabase( const QString& dbname )
         {
             m_db = QSqlDatabase::addDatabase( "QSQLITE", "tomahawk" );
             m_db.setDatabaseName( dbname );
+            m_db.setConnectOptions( QString( "QSQLITE_BUSY_TIMEOUT=%1" ).arg( DATABASE_BUSY_TIMEOUT ) );
             if ( !m_db.open() )
                 throw "db moving failed";
 
@@ -30,6 +30,9 @@
 #include <QSqlQuery>
 #include <QHash>
 #include <QThread>
+#include <QThreadStorage>
+#include <QAtomicInt>
+#include <QMutex>
 
 #include "tomahawksqlquery.h"
 #include "fuzzyindex.h"
@@ -43,6 +46,8 @@ Q_OBJECT
 
 friend class FuzzyIndex;
 friend class DatabaseCommand_UpdateSearchIndex;
+friend class DatabaseCommand_AddFiles;
+friend class DatabaseCommand_DeleteFiles;
 
 public:
     DatabaseImpl( const QString& dbname, Database* parent = 0 );
@@ -50,8 +55,24 @@ public:
 
     bool openDatabase( const QString& dbname );
 
-    TomahawkSqlQuery newquery() { return TomahawkSqlQuery( m_db ); }
-    QSqlDatabase& database() { return m_db; }
+    /**
+     * Opens a private connection to the database file for the calling thread.
+     * Until detachThread() is called, newquery() and database() on that
+     * thread use it instead of the shared "tomahawk" connection.
+     */
+    void attachThread();
+    void detachThread();
+
+    TomahawkSqlQuery newquery() { return TomahawkSqlQuery( database() ); }
+
+    /**
+     * Returns a query already prepared with sql. On threads with their own
+     * connection the compiled statement is kept and handed out again for the
+     * same sql, so bulk inserts don't prepare it once per row or command.
+     * Only bind values and exec() it, finish() it when done reading.
+     */
+    TomahawkSqlQuery preparedQuery( const QString& sql );
+    QSqlDatabase& database();
 
     int artistId( const QString& name_orig, bool autoCreate ); //also for composers!
     int trackId( int artistid, const QString& name_orig, bool autoCreate );
@@ -68,11 +89,8 @@ public:
     QVariantMap track( int id );
     Tomahawk::result_ptr file( int fid );
     Tomahawk::result_ptr resultFromHint( const Tomahawk::query_ptr& query );
-
-    static bool scorepairSorter( const QPair<int,float>& left, const QPair<int,float>& right )
-    {
-        return left.second > right.second;
-    }
+    /// the files of these tracks, with their artist, album, composer & attributes, by track id
+    QHash< unsigned int, QList< Tomahawk::result_ptr > > tracksResults( const QList< int >& trackIds );
 
     QString dbid() const { return m_dbid; }
 
@@ -86,12 +104,18 @@ private slots:
 
 private:
     QString cleanSql( const QString& sql );
+    void loadTrackAttributes( const QList< int >& trackIds, const QList< Tomahawk::result_ptr >& results );
     bool updateSchema( int oldVersion );
     void dumpDatabase();
 
     bool m_ready;
     QSqlDatabase m_db;
+    QString m_dbname;
+    QThreadStorage< QSqlDatabase* > m_threadDb;
+    QThreadStorage< QHash< QString, TomahawkSqlQuery >* > m_preparedQueries;
+    QAtomicInt m_threadDbCount;
 
+    QMutex m_lastMutex;
     QString m_lastart, m_lastalb, m_lasttrk;
     int m_lastartid, m_lastalbid, m_lasttrkid;
 
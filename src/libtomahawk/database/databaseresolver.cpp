@@ -22,20 +22,37 @@
 #include "network/servent.h"
 #include "database/database.h"
 #include "database/databasecommand_resolve.h"
+#include "database/databasecommand_resolvebatch.h"
 
 #include "utils/logger.h"
 
+#define MAX_BATCH_SIZE 500
+
 
 DatabaseResolver::DatabaseResolver( int weight )
     : Resolver()
     , m_weight( weight )
 {
+    m_batchTimer.setSingleShot( true );
+    m_batchTimer.setInterval( 0 );
+    connect( &m_batchTimer, SIGNAL( timeout() ), SLOT( resolvePending() ) );
 }
 
 
 void
 DatabaseResolver::resolve( const Tomahawk::query_ptr& query )
 {
+    if ( !query->isFullTextQuery() )
+    {
+        m_pending << query;
+        if ( m_pending.count() >= MAX_BATCH_SIZE )
+            resolvePending();
+        else if ( !m_batchTimer.isActive() )
+            m_batchTimer.start();
+
+        return;
+    }
+
     DatabaseCommand_Resolve* cmd = new DatabaseCommand_Resolve( query );
 
     connect( cmd, SIGNAL( results( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ),
@@ -46,7 +63,23 @@ DatabaseResolver::resolve( const Tomahawk::query_ptr& query )
                     SLOT( gotArtists( Tomahawk::QID, QList< Tomahawk::artist_ptr > ) ), Qt::QueuedConnection );
 
     Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+}
 
+
+void
+DatabaseResolver::resolvePending()
+{
+    m_batchTimer.stop();
+    if ( m_pending.isEmpty() )
+        return;
+
+    DatabaseCommand_ResolveBatch* cmd = new DatabaseCommand_ResolveBatch( m_pending );
+    m_pending.clear();
+
+    connect( cmd, SIGNAL( results( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ),
+                    SLOT( gotResults( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ), Qt::QueuedConnection );
+
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 }
 
 
@@ -55,7 +88,7 @@ DatabaseResolver::gotResults( const Tomahawk::QID qid, QList< Tomahawk::result_p
 {
     qDebug() << Q_FUNC_INFO << qid << results.length();
 
-    Tomahawk::Pipeline::instance()->reportResults( qid, results );
+    Tomahawk::Pipeline::instance()->reportResults( qid, results, this );
 }
 
 
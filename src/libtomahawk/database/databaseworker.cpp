@@ -34,9 +34,10 @@
     //#define DEBUG_TIMING TRUE
 #endif
 
-DatabaseWorker::DatabaseWorker( DatabaseImpl* lib, Database* db, bool mutates )
+DatabaseWorker::DatabaseWorker( DatabaseImpl* lib, Database* db, bool mutates, bool ownConnection )
     : QThread()
     , m_dbimpl( lib )
+    , m_ownConnection( ownConnection )
     , m_outstanding( 0 )
 {
     Q_UNUSED( db );
@@ -68,7 +69,15 @@ DatabaseWorker::~DatabaseWorker()
 void
 DatabaseWorker::run()
 {
+    // sqlite connections may only be used from the thread that opened them
+    if ( m_ownConnection )
+        m_dbimpl->attachThread();
+
     exec();
+
+    if ( m_ownConnection )
+        m_dbimpl->detachThread();
+
     qDebug() << Q_FUNC_INFO << "DatabaseWorker finishing...";
 }
 
@@ -132,6 +141,9 @@ DatabaseWorker::doWork()
     {
         bool finished = false;
         {
+            // last guid applied per peer source, saved once for the whole group
+            QHash< int, QString > lastOps;
+
             while ( !finished )
             {
                 completed++;
@@ -157,25 +169,16 @@ DatabaseWorker::doWork()
                         // so we can always request just the newer ops in future.
                         //
                         if ( !cmd->singletonCmd() )
-                        {
-                            TomahawkSqlQuery query = m_dbimpl->newquery();
-                            query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
-                            query.addBindValue( cmd->guid() );
-                            query.addBindValue( cmd->source()->id() );
-
-                            if ( !query.exec() )
-                            {
-                                throw "Failed to set lastop";
-                            }
-                        }
+                            lastOps.insert( cmd->source()->id(), cmd->guid() );
                     }
                 }
 
                 cmdGroup << cmd;
-                if ( cmd->groupable() && !m_commands.isEmpty() )
+                if ( cmd->groupable() )
                 {
                     QMutexLocker lock( &m_mut );
-                    if ( m_commands.first()->groupable() )
+                    if ( !m_commands.isEmpty() && m_commands.first()->groupable() &&
+                         m_commands.first()->doesMutates() == cmd->doesMutates() )
                     {
                         cmd = m_commands.takeFirst();
                     }
@@ -188,6 +191,19 @@ DatabaseWorker::doWork()
                     finished = true;
             }
 
+            QHash< int, QString >::const_iterator it = lastOps.constBegin();
+            for ( ; it != lastOps.constEnd(); ++it )
+            {
+                TomahawkSqlQuery query = m_dbimpl->preparedQuery( "UPDATE source SET lastop = ? WHERE id = ?" );
+                query.bindValue( 0, it.value() );
+                query.bindValue( 1, it.key() );
+
+                if ( !query.exec() )
+                {
+                    throw "Failed to set lastop";
+                }
+            }
+
             if ( cmd->doesMutates() )
             {
                 qDebug() << "Committing" << cmd->commandname() << cmd->guid();
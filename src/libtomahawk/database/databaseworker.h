@@ -39,7 +39,7 @@ class DatabaseWorker : public QThread
 Q_OBJECT
 
 public:
-    DatabaseWorker( DatabaseImpl*, Database*, bool mutates );
+    DatabaseWorker( DatabaseImpl*, Database*, bool mutates, bool ownConnection = false );
     ~DatabaseWorker();
 
     bool busy() const { return m_outstanding > 0; }
@@ -60,6 +60,7 @@ private:
 
     QMutex m_mut;
     DatabaseImpl* m_dbimpl;
+    bool m_ownConnection;
     QList< QSharedPointer<DatabaseCommand> > m_commands;
     int m_outstanding;
 
@@ -20,6 +20,7 @@
 
 #include <QDir>
 #include <QTime>
+#include <QTimer>
 
 #include <CLucene.h>
 #include <CLucene/queryParser/MultiFieldQueryParser.h>
@@ -36,13 +37,110 @@ using namespace lucene::index;
 using namespace lucene::queryParser;
 using namespace lucene::search;
 
+// during bulk updates, e.g. syncing a peer's collection, searches see changes this much later at most (ms)
+#define SNAPSHOT_PUBLISH_INTERVAL 5000
+
+
+struct FuzzyIndex::IndexSnapshot
+{
+    IndexSnapshot( IndexReader* r )
+        : reader( r )
+        , searcher( _CLNEW IndexSearcher( r ) )
+        , trackIdsLoaded( false )
+        , albumIdsLoaded( false )
+    {
+    }
+
+    ~IndexSnapshot()
+    {
+        try
+        {
+            searcher->close();
+            reader->close();
+        }
+        catch( CLuceneError& error )
+        {
+            tDebug() << "Caught CLucene error:" << error.what();
+        }
+
+        delete searcher;
+        delete reader;
+    }
+
+    // map document numbers to database ids once per snapshot, so hits never have to load
+    // their stored fields and parse them back into numbers. That walks all ids in the index,
+    // so it only happens on the first search: the small updates of a scan publish many
+    // snapshots in a row, most of which never get searched.
+    QVector< int > trackIds()
+    {
+        QMutexLocker lock( &idsMutex );
+        if ( !trackIdsLoaded )
+            loadIds( _T( "trackid" ), trackIdsByDoc );
+        trackIdsLoaded = true;
+
+        return trackIdsByDoc;
+    }
+
+    QVector< int > albumIds()
+    {
+        QMutexLocker lock( &idsMutex );
+        if ( !albumIdsLoaded )
+            loadIds( _T( "albumid" ), albumIdsByDoc );
+        albumIdsLoaded = true;
+
+        return albumIdsByDoc;
+    }
+
+    void loadIds( const TCHAR* field, QVector< int >& ids )
+    {
+        ids.fill( -1, reader->maxDoc() );
+
+        Term* start = _CLNEW Term( field, _T( "" ) );
+        TermEnum* terms = reader->terms( start );
+        TermDocs* docs = reader->termDocs();
+        _CLDECDELETE( start );
+
+        do
+        {
+            Term* term = terms->term( false );
+            if ( !term || _tcscmp( term->field(), field ) != 0 )
+                break;
+
+            int id = (int)_tcstol( term->text(), NULL, 10 );
+            docs->seek( terms );
+            while ( docs->next() )
+                ids[ docs->doc() ] = id;
+        }
+        while ( terms->next() );
+
+        docs->close();
+        _CLDELETE( docs );
+        terms->close();
+        _CLDELETE( terms );
+    }
+
+    IndexReader* reader;
+    IndexSearcher* searcher;
+
+    QMutex idsMutex; // concurrent searches share the snapshot
+    bool trackIdsLoaded;
+    bool albumIdsLoaded;
+
+    // database id per document number, -1 for documents of the other kind
+    QVector< int > trackIdsByDoc;
+    QVector< int > albumIdsByDoc;
+};
+
 
 FuzzyIndex::FuzzyIndex( DatabaseImpl& db, bool wipeIndex )
     : QObject()
     , m_db( db )
-    , m_luceneReader( 0 )
-    , m_luceneSearcher( 0 )
+    , m_publishPending( false )
 {
+    m_publishTimer = new QTimer( this );
+    m_publishTimer->setSingleShot( true );
+    connect( m_publishTimer, SIGNAL( timeout() ), SLOT( publishPending() ) );
+
     QString m_lucenePath = TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" );
     m_luceneDir = FSDirectory::getDirectory( m_lucenePath.toStdString().c_str() );
     m_analyzer = _CLNEW SimpleAnalyzer();
@@ -58,8 +156,7 @@ FuzzyIndex::FuzzyIndex( DatabaseImpl& db, bool wipeIndex )
 
 FuzzyIndex::~FuzzyIndex()
 {
-    delete m_luceneSearcher;
-    delete m_luceneReader;
+    m_snapshot.clear();
     delete m_analyzer;
     delete m_luceneDir;
 }
@@ -72,18 +169,9 @@ FuzzyIndex::beginIndexing()
 
     try
     {
+        // searches keep using the current snapshot, a reader's view of
+        // the index stays intact while the writer recreates it
         qDebug() << Q_FUNC_INFO << "Starting indexing.";
-        if ( m_luceneReader != 0 )
-        {
-            qDebug() << "Deleting old lucene stuff.";
-            m_luceneSearcher->close();
-            m_luceneReader->close();
-            delete m_luceneSearcher;
-            delete m_luceneReader;
-            m_luceneSearcher = 0;
-            m_luceneReader = 0;
-        }
-
         qDebug() << "Creating new index writer.";
         IndexWriter luceneWriter( m_luceneDir, m_analyzer, true );
     }
@@ -98,6 +186,7 @@ FuzzyIndex::beginIndexing()
 void
 FuzzyIndex::endIndexing()
 {
+    publishSnapshot();
     m_mutex.unlock();
     emit indexReady();
 }
@@ -111,46 +200,8 @@ FuzzyIndex::appendFields( const QMap< unsigned int, QMap< QString, QString > >&
         tDebug() << "Appending to index:" << trackData.count();
         bool create = !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() );
         IndexWriter luceneWriter( m_luceneDir, m_analyzer, create );
-        Document doc;
 
-        QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
-        while ( it.hasNext() )
-        {
-            it.next();
-            unsigned int id = it.key();
-            QMap< QString, QString > values = it.value();
-
-            if ( values.contains( "track" ) )
-            {
-                doc.add( *( _CLNEW Field( _T( "fulltext" ), DatabaseImpl::sortname( QString( "%1 %2" ).arg( values.value( "artist" ) ).arg( values.value( "track" ) ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
-
-                doc.add( *( _CLNEW Field( _T( "track" ), DatabaseImpl::sortname( values.value( "track" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
-
-                doc.add( *( _CLNEW Field( _T( "artist" ), DatabaseImpl::sortname( values.value( "artist" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
-
-                doc.add( *( _CLNEW Field( _T( "artistid" ), values.value( "artistid" ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
-
-                doc.add( *( _CLNEW Field( _T( "trackid" ), QString::number( id ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
-            }
-            else if ( values.contains( "album" ) )
-            {
-                doc.add( *( _CLNEW Field( _T( "album" ), DatabaseImpl::sortname( values.value( "album" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
-
-                doc.add( *( _CLNEW Field( _T( "albumid" ), QString::number( id ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
-            }
-            else
-                Q_ASSERT( false );
-
-            luceneWriter.addDocument( &doc );
-            doc.clear();
-        }
+        addDocuments( luceneWriter, trackData );
 
         luceneWriter.optimize();
         luceneWriter.close();
@@ -164,31 +215,298 @@ FuzzyIndex::appendFields( const QMap< unsigned int, QMap< QString, QString > >&
 
 
 void
-FuzzyIndex::loadLuceneIndex()
+FuzzyIndex::updateFields( const QMap< unsigned int, QMap< QString, QString > >& trackData )
 {
-    emit indexReady();
+    if ( trackData.isEmpty() )
+        return;
+
+    QMutexLocker lock( &m_mutex );
+
+    QList< unsigned int > trackIds, albumIds;
+    QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
+    while ( it.hasNext() )
+    {
+        it.next();
+        if ( it.value().contains( "track" ) )
+            trackIds << it.key();
+        else
+            albumIds << it.key();
+    }
+
+    try
+    {
+        tDebug() << "Updating index:" << trackIds.count() << "tracks," << albumIds.count() << "albums";
+        deleteDocuments( trackIds, albumIds );
+
+        bool create = !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() );
+        IndexWriter luceneWriter( m_luceneDir, m_analyzer, create );
+
+        // no optimize() here, merging segments is left to the next full rebuild
+        addDocuments( luceneWriter, trackData );
+        luceneWriter.close();
+
+        publishSnapshotThrottled();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
 }
 
 
-QMap< int, float >
-FuzzyIndex::search( const Tomahawk::query_ptr& query )
+void
+FuzzyIndex::deleteFields( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds )
 {
+    if ( trackIds.isEmpty() && albumIds.isEmpty() )
+        return;
+
     QMutexLocker lock( &m_mutex );
 
-    QMap< int, float > resultsmap;
     try
     {
-        if ( !m_luceneReader )
+        tDebug() << "Removing from index:" << trackIds.count() << "tracks," << albumIds.count() << "albums";
+        deleteDocuments( trackIds, albumIds );
+        publishSnapshotThrottled();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+}
+
+
+FuzzyIndex::snapshot_ptr
+FuzzyIndex::snapshot()
+{
+    QMutexLocker lock( &m_snapshotMutex );
+    if ( m_snapshot.isNull() )
+    {
+        if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
+        {
+            qDebug() << Q_FUNC_INFO << "index didn't exist.";
+            return m_snapshot;
+        }
+
+        m_snapshot = snapshot_ptr( new IndexSnapshot( IndexReader::open( m_luceneDir ) ) );
+    }
+
+    return m_snapshot;
+}
+
+
+void
+FuzzyIndex::publishSnapshot()
+{
+    snapshot_ptr fresh;
+    try
+    {
+        if ( IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
+            fresh = snapshot_ptr( new IndexSnapshot( IndexReader::open( m_luceneDir ) ) );
+    }
+    catch( CLuceneError& error )
+    {
+        tDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+
+    // the old snapshot is closed once the last search still using it lets go
+    snapshot_ptr old;
+    {
+        QMutexLocker lock( &m_snapshotMutex );
+        old = m_snapshot;
+        m_snapshot = fresh;
+    }
+
+    m_lastPublish.start();
+    m_publishPending = false;
+}
+
+
+void
+FuzzyIndex::publishSnapshotThrottled()
+{
+    if ( m_lastPublish.isNull() || m_lastPublish.elapsed() >= SNAPSHOT_PUBLISH_INTERVAL )
+    {
+        publishSnapshot();
+        return;
+    }
+
+    if ( m_publishPending )
+        return;
+
+    // writers run on the database worker threads, the timer belongs to ours
+    m_publishPending = true;
+    QMetaObject::invokeMethod( this, "startPublishTimer", Qt::QueuedConnection,
+                               Q_ARG( int, SNAPSHOT_PUBLISH_INTERVAL - m_lastPublish.elapsed() ) );
+}
+
+
+void
+FuzzyIndex::startPublishTimer( int delay )
+{
+    if ( !m_publishTimer->isActive() )
+        m_publishTimer->start( qMax( 0, delay ) );
+}
+
+
+void
+FuzzyIndex::publishPending()
+{
+    // don't wait for a writer here, e.g. a full rebuild. try again a bit later instead
+    if ( !m_mutex.tryLock() )
+    {
+        m_publishTimer->start( 500 );
+        return;
+    }
+
+    const bool pending = m_publishPending;
+    if ( pending )
+        publishSnapshot();
+    m_mutex.unlock();
+
+    // the refresh triggered by the update itself ran against the older snapshot
+    if ( pending )
+        emit indexReady();
+}
+
+
+void
+FuzzyIndex::deleteDocuments( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds )
+{
+    if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
+        return;
+
+    // deleting needs the index write lock, so this has to happen before opening an IndexWriter
+    IndexReader* reader = IndexReader::open( m_luceneDir );
+    foreach ( unsigned int id, trackIds )
+    {
+        Term* term = _CLNEW Term( _T( "trackid" ), QString::number( id ).toStdWString().c_str() );
+        reader->deleteDocuments( term );
+        _CLDECDELETE( term );
+    }
+    foreach ( unsigned int id, albumIds )
+    {
+        Term* term = _CLNEW Term( _T( "albumid" ), QString::number( id ).toStdWString().c_str() );
+        reader->deleteDocuments( term );
+        _CLDECDELETE( term );
+    }
+
+    reader->close();
+    _CLDELETE( reader );
+}
+
+
+void
+FuzzyIndex::addDocuments( IndexWriter& luceneWriter, const QMap< unsigned int, QMap< QString, QString > >& trackData )
+{
+    Document doc;
+
+    QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
+    while ( it.hasNext() )
+    {
+        it.next();
+        unsigned int id = it.key();
+        QMap< QString, QString > values = it.value();
+
+        if ( values.contains( "track" ) )
+        {
+            doc.add( *( _CLNEW Field( _T( "fulltext" ), DatabaseImpl::sortname( QString( "%1 %2" ).arg( values.value( "artist" ) ).arg( values.value( "track" ) ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "track" ), DatabaseImpl::sortname( values.value( "track" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "artist" ), DatabaseImpl::sortname( values.value( "artist" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "artistid" ), values.value( "artistid" ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_NO ) ) );
+
+            // indexed, so single documents can be replaced or removed by id
+            doc.add( *( _CLNEW Field( _T( "trackid" ), QString::number( id ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_UNTOKENIZED ) ) );
+        }
+        else if ( values.contains( "album" ) )
         {
-            if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
-            {
-                qDebug() << Q_FUNC_INFO << "index didn't exist.";
-                return resultsmap;
-            }
-
-            m_luceneReader = IndexReader::open( m_luceneDir );
-            m_luceneSearcher = _CLNEW IndexSearcher( m_luceneReader );
+            doc.add( *( _CLNEW Field( _T( "album" ), DatabaseImpl::sortname( values.value( "album" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "albumid" ), QString::number( id ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_UNTOKENIZED ) ) );
         }
+        else
+            Q_ASSERT( false );
+
+        luceneWriter.addDocument( &doc );
+        doc.clear();
+    }
+}
+
+
+void
+FuzzyIndex::loadLuceneIndex()
+{
+    emit indexReady();
+}
+
+
+QList< QPair<int, float> >
+FuzzyIndex::collectHits( const snapshot_ptr& index, Query* qry, const QVector< int >& ids, float minScore, uint limit )
+{
+    QList< QPair<int, float> > resultslist;
+
+    if ( limit )
+    {
+        // the searcher keeps the best hits in a bounded priority queue, so only
+        // limit candidates are ever materialized, already ordered by score
+        TopDocs* top = index->searcher->_search( qry, NULL, limit );
+
+        // normalize like Hits does, so scores don't depend on the limit
+        float norm = 1.0;
+        if ( top->scoreDocsLength > 0 && top->scoreDocs[ 0 ].score > 1.0 )
+            norm = 1.0 / top->scoreDocs[ 0 ].score;
+
+        for ( int i = 0; i < top->scoreDocsLength; i++ )
+        {
+            float score = top->scoreDocs[ i ].score * norm;
+            int id = ids.value( top->scoreDocs[ i ].doc, -1 );
+
+            if ( score > minScore && id >= 0 )
+                resultslist << QPair<int, float>( id, score );
+        }
+
+        _CLDELETE( top );
+    }
+    else
+    {
+        Hits* hits = index->searcher->search( qry );
+        for ( uint i = 0; i < hits->length(); i++ )
+        {
+            float score = hits->score( i );
+            int id = ids.value( hits->id( i ), -1 );
+
+            if ( score > minScore && id >= 0 )
+                resultslist << QPair<int, float>( id, score );
+        }
+
+        delete hits;
+    }
+
+    return resultslist;
+}
+
+
+QList< QPair<int, float> >
+FuzzyIndex::search( const Tomahawk::query_ptr& query, uint limit )
+{
+    QList< QPair<int, float> > resultslist;
+    try
+    {
+        snapshot_ptr index = snapshot();
+        if ( index.isNull() )
+            return resultslist;
 
         float minScore;
         const TCHAR** fields = 0;
@@ -230,22 +548,7 @@ FuzzyIndex::search( const Tomahawk::query_ptr& query )
             minScore = 0.00;
         }
 
-        Hits* hits = m_luceneSearcher->search( qry );
-        for ( uint i = 0; i < hits->length(); i++ )
-        {
-            Document* d = &hits->doc( i );
-
-            float score = hits->score( i );
-            int id = QString::fromWCharArray( d->get( _T( "trackid" ) ) ).toInt();
-
-            if ( score > minScore )
-            {
-                resultsmap.insert( id, score );
-//                tDebug() << "Index hit:" << id << score << QString::fromWCharArray( ((Query*)qry)->toString() );
-            }
-        }
-
-        delete hits;
+        resultslist = collectHits( index, qry, index->trackIds(), minScore, limit );
         delete qry;
     }
     catch( CLuceneError& error )
@@ -254,52 +557,27 @@ FuzzyIndex::search( const Tomahawk::query_ptr& query )
         Q_ASSERT( false );
     }
 
-    return resultsmap;
+    return resultslist;
 }
 
 
-QMap< int, float >
-FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
+QList< QPair<int, float> >
+FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query, uint limit )
 {
     Q_ASSERT( query->isFullTextQuery() );
 
-    QMutexLocker lock( &m_mutex );
-
-    QMap< int, float > resultsmap;
+    QList< QPair<int, float> > resultslist;
     try
     {
-        if ( !m_luceneReader )
-        {
-            if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
-            {
-                qDebug() << Q_FUNC_INFO << "index didn't exist.";
-                return resultsmap;
-            }
-
-            m_luceneReader = IndexReader::open( m_luceneDir );
-            m_luceneSearcher = _CLNEW IndexSearcher( m_luceneReader );
-        }
+        snapshot_ptr index = snapshot();
+        if ( index.isNull() )
+            return resultslist;
 
         QueryParser parser( _T( "album" ), m_analyzer );
         QString escapedName = QString::fromWCharArray( parser.escape( DatabaseImpl::sortname( query->fullTextQuery() ).toStdWString().c_str() ) );
 
         Query* qry = _CLNEW FuzzyQuery( _CLNEW Term( _T( "album" ), escapedName.toStdWString().c_str() ) );
-        Hits* hits = m_luceneSearcher->search( qry );
-        for ( uint i = 0; i < hits->length(); i++ )
-        {
-            Document* d = &hits->doc( i );
-
-            float score = hits->score( i );
-            int id = QString::fromWCharArray( d->get( _T( "albumid" ) ) ).toInt();
-
-            if ( score > 0.30 )
-            {
-                resultsmap.insert( id, score );
-//                tDebug() << "Index hit:" << id << score;
-            }
-        }
-
-        delete hits;
+        resultslist = collectHits( index, qry, index->albumIds(), 0.30, limit );
         delete qry;
     }
     catch( CLuceneError& error )
@@ -308,5 +586,5 @@ FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
         Q_ASSERT( false );
     }
 
-    return resultsmap;
+    return resultslist;
 }
@@ -22,8 +22,12 @@
 #include <QObject>
 #include <QMap>
 #include <QHash>
+#include <QPair>
 #include <QString>
+#include <QVector>
 #include <QMutex>
+#include <QSharedPointer>
+#include <QTime>
 
 #include "query.h"
 
@@ -45,10 +49,15 @@ namespace lucene
     namespace search
     {
       class IndexSearcher;
+      class Query;
     }
 }
 
+// bump this whenever the document layout changes, it forces a full rebuild
+#define FUZZYINDEX_VERSION 3
+
 class DatabaseImpl;
+class QTimer;
 
 class FuzzyIndex : public QObject
 {
@@ -61,25 +70,53 @@ public:
     void beginIndexing();
     void endIndexing();
     void appendFields( const QMap< unsigned int, QMap< QString, QString > >& trackData );
-    
+
+    // incremental updates, replacing or removing existing documents by track / album id
+    void updateFields( const QMap< unsigned int, QMap< QString, QString > >& trackData );
+    void deleteFields( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds );
+
 signals:
     void indexReady();
 
+private slots:
+    void startPublishTimer( int delay );
+    void publishPending();
+
 public slots:
     void loadLuceneIndex();
 
-    QMap< int, float > search( const Tomahawk::query_ptr& query );
-    QMap< int, float > searchAlbum( const Tomahawk::query_ptr& query );
+    // hits ordered by descending score, at most limit of them (0 means unlimited)
+    QList< QPair<int, float> > search( const Tomahawk::query_ptr& query, uint limit = 0 );
+    QList< QPair<int, float> > searchAlbum( const Tomahawk::query_ptr& query, uint limit = 0 );
 
 private:
+    struct IndexSnapshot;
+    typedef QSharedPointer< IndexSnapshot > snapshot_ptr;
+
+    snapshot_ptr snapshot();
+    QList< QPair<int, float> > collectHits( const snapshot_ptr& index, lucene::search::Query* qry, const QVector< int >& ids, float minScore, uint limit );
+    void publishSnapshot();
+    void publishSnapshotThrottled();
+    void deleteDocuments( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds );
+    void addDocuments( lucene::index::IndexWriter& writer, const QMap< unsigned int, QMap< QString, QString > >& trackData );
+
     DatabaseImpl& m_db;
-    QMutex m_mutex;
+    QMutex m_mutex; // serializes writers only
     QString m_lucenePath;
 
     lucene::analysis::SimpleAnalyzer* m_analyzer;
     lucene::store::Directory* m_luceneDir;
-    lucene::index::IndexReader* m_luceneReader;
-    lucene::search::IndexSearcher* m_luceneSearcher;
+
+    // searches run against an immutable reader/searcher pair, which writers replace
+    // when they're done. m_snapshotMutex only guards swapping & copying the pointer.
+    QMutex m_snapshotMutex;
+    snapshot_ptr m_snapshot;
+
+    // incremental updates publish a new snapshot at most every SNAPSHOT_PUBLISH_INTERVAL,
+    // each one costs a walk over all ids on its first search. guarded by m_mutex
+    QTime m_lastPublish;
+    bool m_publishPending;
+    QTimer* m_publishTimer;
 };
 
 #endif // FUZZYINDEX_H
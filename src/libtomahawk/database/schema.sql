@@ -252,7 +252,7 @@ CREATE TABLE IF NOT EXISTS social_attributes (
     v TEXT NOT NULL,
     timestamp INTEGER NOT NULL DEFAULT 0
 );
-CREATE INDEX social_attrib_id        ON social_attributes(id);
+CREATE INDEX social_attrib_id_timestamp ON social_attributes(id, timestamp);
 CREATE INDEX social_attrib_source    ON social_attributes(source);
 CREATE INDEX social_attrib_k         ON social_attributes(k);
 CREATE INDEX social_attrib_timestamp ON social_attributes(timestamp);
@@ -270,7 +270,8 @@ CREATE TABLE IF NOT EXISTS playback_log (
     secs_played INTEGER NOT NULL
 );
 
-CREATE INDEX playback_log_source ON playback_log(source);
+CREATE INDEX playback_log_source_playtime ON playback_log(source, playtime, track);
+CREATE INDEX playback_log_playtime ON playback_log(playtime, track, source);
 CREATE INDEX playback_log_track ON playback_log(track);
 
 
@@ -295,4 +296,4 @@ CREATE TABLE IF NOT EXISTS settings (
     v TEXT NOT NULL DEFAULT ''
 );
 
-INSERT INTO settings(k,v) VALUES('schema_version', '28');
+INSERT INTO settings(k,v) VALUES('schema_version', '30');
@@ -166,7 +166,7 @@ static const char * tomahawk_schema_sql =
 "    v TEXT NOT NULL,"
 "    timestamp INTEGER NOT NULL DEFAULT 0"
 ");"
-"CREATE INDEX social_attrib_id        ON social_attributes(id);"
+"CREATE INDEX social_attrib_id_timestamp ON social_attributes(id, timestamp);"
 "CREATE INDEX social_attrib_source    ON social_attributes(source);"
 "CREATE INDEX social_attrib_k         ON social_attributes(k);"
 "CREATE INDEX social_attrib_timestamp ON social_attributes(timestamp);"
@@ -177,7 +177,8 @@ static const char * tomahawk_schema_sql =
 "    playtime INTEGER NOT NULL,              "
 "    secs_played INTEGER NOT NULL"
 ");"
-"CREATE INDEX playback_log_source ON playback_log(source);"
+"CREATE INDEX playback_log_source_playtime ON playback_log(source, playtime, track);"
+"CREATE INDEX playback_log_playtime ON playback_log(playtime, track, source);"
 "CREATE INDEX playback_log_track ON playback_log(track);"
 "CREATE TABLE IF NOT EXISTS http_client_auth ("
 "    token TEXT NOT NULL PRIMARY KEY,"
@@ -191,7 +192,7 @@ static const char * tomahawk_schema_sql =
 "    k TEXT NOT NULL PRIMARY KEY,"
 "    v TEXT NOT NULL DEFAULT ''"
 ");"
-"INSERT INTO settings(k,v) VALUES('schema_version', '28');"
+"INSERT INTO settings(k,v) VALUES('schema_version', '30');"
     ;
 
 const char * get_tomahawk_sql()
@@ -505,7 +505,7 @@ GlobalActionManager::doQueueAdd( const QStringList& parts, const QList< QPair< Q
             query_ptr q = Query::get( artist, title, album, uuid(), false );
             if ( !urlStr.isEmpty() )
                 q->setResultHint( urlStr );
-            Pipeline::instance()->resolve( q, true );
+            Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
             handleOpenTrack( q );
             return true;
@@ -529,7 +529,7 @@ GlobalActionManager::doQueueAdd( const QStringList& parts, const QList< QPair< Q
                     query_ptr q = Query::get( QString(), info.baseName(), QString(), uuid(), false );
                     q->setResultHint( track.toString() );
 
-                    Pipeline::instance()->resolve( q, true );
+                    Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
                     ViewManager::instance()->queue()->model()->append( q );
                     ViewManager::instance()->showQueue();
@@ -919,7 +919,7 @@ void
 GlobalActionManager::playNow( const query_ptr& q )
 {
 
-    Pipeline::instance()->resolve( q, true );
+    Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
     m_waitingToPlay = q;
     q->setProperty( "playNow", true );
@@ -930,7 +930,7 @@ GlobalActionManager::playNow( const query_ptr& q )
 void
 GlobalActionManager::playOrQueueNow( const query_ptr& q )
 {
-    Pipeline::instance()->resolve( q, true );
+    Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
     m_waitingToPlay = q;
     connect( q.data(), SIGNAL( resolvingFinished( bool ) ), this, SLOT( waitingForResolved( bool ) ) );
@@ -979,7 +979,7 @@ bool GlobalActionManager::handleBookmarkCommand(const QUrl& url)
         query_ptr q = Query::get( artist, title, album );
         if ( !urlStr.isEmpty() )
             q->setResultHint( urlStr );
-        Pipeline::instance()->resolve( q, true );
+        Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
         // now we add it to the special "bookmarks" playlist, creating it if it doesn't exist. if nothing is playing, start playing the track
         QSharedPointer< LocalCollection > col = SourceList::instance()->getLocal()->collection().dynamicCast< LocalCollection >();
@@ -30,13 +30,18 @@
 TransferStatusItem::TransferStatusItem( TransferStatusManager* p, StreamConnection* sc )
     : m_parent( p )
     , m_stream( QWeakPointer< StreamConnection >( sc ) )
+    , m_transferRate( 0 )
+    , m_track( sc->track() )
+    , m_source( sc->source() )
+    , m_streamType( sc->type() )
 {
-    if ( m_stream.data()->type() == StreamConnection::RECEIVING )
+    if ( m_streamType == StreamConnection::RECEIVING )
         m_type = "receive";
     else
         m_type = "send";
 
-    connect( m_stream.data(), SIGNAL( updated() ), SLOT( onTransferUpdate() ) );
+    connect( sc, SIGNAL( updated( qint64, Tomahawk::result_ptr, Tomahawk::source_ptr, int ) ),
+                   SLOT( onTransferUpdate( qint64, Tomahawk::result_ptr, Tomahawk::source_ptr, int ) ), Qt::QueuedConnection );
     connect( Servent::instance(), SIGNAL( streamFinished( StreamConnection* ) ), SLOT( streamFinished( StreamConnection* ) ) );
 }
 
@@ -48,42 +53,36 @@ TransferStatusItem::~TransferStatusItem()
 QString
 TransferStatusItem::mainText() const
 {
-    if ( m_stream.isNull() )
+    if ( m_track.isNull() )
         return QString();
 
-    if ( m_stream.data()->source().isNull() && !m_stream.data()->track().isNull() )
-        return QString( "%1" ).arg( QString( "%1 - %2" ).arg( m_stream.data()->track()->artist()->name() ).arg( m_stream.data()->track()->track() ) );
-    else if ( !m_stream.data()->source().isNull() && !m_stream.data()->track().isNull() )
-        return QString( "%1 %2 %3" ).arg( QString( "%1 - %2" ).arg( m_stream.data()->track()->artist()->name() ).arg( m_stream.data()->track()->track() ) )
-                                .arg( m_stream.data()->type() == StreamConnection::RECEIVING ? tr( "from" ) : tr( "to" ) )
-                                .arg( m_stream.data()->source()->friendlyName() );
-    else
-        return QString();
+    const QString track = QString( "%1 - %2" ).arg( m_track->artist()->name() ).arg( m_track->track() );
+    if ( m_source.isNull() )
+        return track;
+
+    return QString( "%1 %2 %3" ).arg( track )
+                                .arg( m_streamType == StreamConnection::RECEIVING ? tr( "from" ) : tr( "to" ) )
+                                .arg( m_source->friendlyName() );
 }
 
 QString
 TransferStatusItem::rightColumnText() const
 {
-    if ( m_stream.isNull() )
-        return QString();
-
-    return QString( "%1 kb/s" ).arg( m_stream.data()->transferRate() / 1024 );
+    return QString( "%1 kb/s" ).arg( m_transferRate / 1024 );
 }
 
 void
 TransferStatusItem::streamFinished( StreamConnection* sc )
 {
-    if ( m_stream.data() == sc )
+    // streams live in the network thread, they might be gone by the time we hear about it
+    if ( m_stream.isNull() || m_stream.data() == sc )
         emit finished();
 }
 
 QPixmap
 TransferStatusItem::icon() const
 {
-    if ( m_stream.isNull() )
-        return QPixmap();
-
-    if ( m_stream.data()->type() == StreamConnection::SENDING )
+    if ( m_streamType == StreamConnection::SENDING )
         return m_parent->rxPixmap();
    else
        return m_parent->txPixmap();
@@ -91,8 +90,13 @@ TransferStatusItem::icon() const
 
 
 void
-TransferStatusItem::onTransferUpdate()
+TransferStatusItem::onTransferUpdate( qint64 transferRate, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, int type )
 {
+    m_transferRate = transferRate;
+    m_track = track;
+    m_source = source;
+    m_streamType = type;
+
     emit statusChanged();
 }
 
@@ -103,11 +107,23 @@ TransferStatusManager::TransferStatusManager( QObject* parent )
     m_rxPixmap.load( RESPATH "images/uploading.png" );
     m_txPixmap.load( RESPATH "images/downloading.png" );
 
-    connect( Servent::instance(), SIGNAL( streamStarted( StreamConnection* ) ), SLOT( streamRegistered( StreamConnection* ) ) );
+    // direct, streams get registered while they're being created, so sc is still safe to use there
+    connect( Servent::instance(), SIGNAL( streamStarted( StreamConnection* ) ),
+                                    SLOT( streamRegistered( StreamConnection* ) ), Qt::DirectConnection );
 }
 
 void
 TransferStatusManager::streamRegistered( StreamConnection* sc )
 {
-    JobStatusView::instance()->model()->addJob( new TransferStatusItem( this, sc ) );
+    // this runs in the thread creating the stream, the item belongs to the GUI thread
+    TransferStatusItem* item = new TransferStatusItem( this, sc );
+    item->moveToThread( thread() );
+
+    QMetaObject::invokeMethod( this, "addItem", Qt::QueuedConnection, Q_ARG( QObject*, item ) );
+}
+
+void
+TransferStatusManager::addItem( QObject* item )
+{
+    JobStatusView::instance()->model()->addJob( qobject_cast< TransferStatusItem* >( item ) );
 }
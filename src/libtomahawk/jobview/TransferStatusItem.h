@@ -20,8 +20,10 @@
 #define TRANSFERSTATUSITEM_H
 
 #include "JobStatusItem.h"
+#include "typedefs.h"
 
 #include <QPixmap>
+#include <QWeakPointer>
 
 class StreamConnection;
 
@@ -37,6 +39,7 @@ public:
 
 private slots:
     void streamRegistered( StreamConnection* sc );
+    void addItem( QObject* item );
 
 private:
     QPixmap m_rxPixmap, m_txPixmap;
@@ -56,12 +59,18 @@ public:
 
 private slots:
     void streamFinished( StreamConnection* sc );
-    void onTransferUpdate();
+    void onTransferUpdate( qint64 transferRate, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, int type );
 
 private:
     TransferStatusManager* m_parent;
     QString m_type, m_main, m_right;
+
+    // the stream lives in the network thread, it's only ever compared against, never called
     QWeakPointer< StreamConnection > m_stream;
+    qint64 m_transferRate;
+    Tomahawk::result_ptr m_track;
+    Tomahawk::source_ptr m_source;
+    int m_streamType;
 };
 
 #endif // TRANSFERSTATUSITEM_H
@@ -21,19 +21,34 @@
 
 #include <QCoreApplication>
 #include <QThread>
+#include <QTemporaryFile>
+#include <QDir>
 
 #include "utils/logger.h"
 
 // Msgs are framed, this is the size each msg we send containing audio data:
 #define BLOCKSIZE 4096
+// received data kept in memory, anything beyond goes to a temporary file
+#define MEMORY_LIMIT ( 8 * 1024 * 1024 )
 
 
 BufferIODevice::BufferIODevice( unsigned int size, QObject* parent )
     : QIODevice( parent )
+    , m_firstEmpty( 0 )
+    , m_memory( 0 )
+    , m_spillFile( 0 )
+    , m_spillFailed( false )
     , m_size( size )
     , m_received( 0 )
     , m_pos( 0 )
 {
+    m_receivedBlocks.resize( blockCount() );
+}
+
+
+BufferIODevice::~BufferIODevice()
+{
+    delete m_spillFile;
 }
 
 
@@ -98,27 +113,87 @@ BufferIODevice::inputComplete( const QString& errmsg )
 void
 BufferIODevice::addData( int block, const QByteArray& ba )
 {
+    bool lastBlock;
+    int nextEmpty;
     {
         QMutexLocker lock( &m_mut );
 
-        while ( m_buffer.count() <= block )
-            m_buffer << QByteArray();
+        if ( m_receivedBlocks.size() <= block )
+            m_receivedBlocks.resize( block + 1 );
+
+        if ( m_receivedBlocks.testBit( block ) )
+        {
+            // resent after a seek, we already got that one
+            return;
+        }
+
+        m_receivedBlocks.setBit( block );
+        m_buffer.insert( block, ba );
+        m_memory += ba.size();
+        m_received += ba.count();
+
+        // only ever moves forward, so finding the next gap costs O(1) per block overall
+        while ( m_firstEmpty < m_receivedBlocks.size() && m_receivedBlocks.testBit( m_firstEmpty ) )
+            m_firstEmpty++;
 
-        m_buffer.replace( block, ba );
+        if ( m_memory > MEMORY_LIMIT )
+            spillBlocks();
+
+        lastBlock = ( block + 1 == blockCount() );
+        nextEmpty = m_firstEmpty < blockCount() ? m_firstEmpty : -1;
     }
 
     // If this was the last block of the transfer, check if we need to fill up gaps
-    if ( block + 1 == maxBlocks() )
+    if ( lastBlock && nextEmpty >= 0 )
+        emit blockRequest( nextEmpty );
+
+    emit bytesWritten( ba.count() );
+    emit readyRead();
+}
+
+
+void
+BufferIODevice::spillBlocks()
+{
+    if ( m_spillFailed )
+        return;
+
+    if ( !m_spillFile )
     {
-        if ( nextEmptyBlock() >= 0 )
+        m_spillFile = new QTemporaryFile( QDir::tempPath() + "/tomahawk_stream_XXXXXX" );
+        if ( !m_spillFile->open() )
         {
-            emit blockRequest( nextEmptyBlock() );
+            tLog() << "Could not open temporary file for stream data, keeping it all in memory";
+            delete m_spillFile;
+            m_spillFile = 0;
+            m_spillFailed = true;
+            return;
         }
     }
 
-    m_received += ba.count();
-    emit bytesWritten( ba.count() );
-    emit readyRead();
+    // drop what was played already first, then what is needed last
+    const int readBlock = blockForPos( m_pos );
+    while ( m_memory > MEMORY_LIMIT / 2 && !m_buffer.isEmpty() )
+    {
+        QMap< int, QByteArray >::iterator it = m_buffer.begin();
+        if ( it.key() >= readBlock )
+        {
+            it = m_buffer.end();
+            --it;
+        }
+
+        if ( !m_spillFile->seek( (qint64)it.key() * BLOCKSIZE ) ||
+             m_spillFile->write( it.value() ) != it.value().size() )
+        {
+            tLog() << "Failed writing stream data to temporary file, keeping it in memory";
+            m_spillFailed = true;
+            return;
+        }
+
+        m_spilled.insert( it.key(), it.value().size() );
+        m_memory -= it.value().size();
+        m_buffer.erase( it );
+    }
 }
 
 
@@ -137,14 +212,45 @@ BufferIODevice::readData( char* data, qint64 maxSize )
     if ( atEnd() )
         return 0;
 
-    QByteArray ba;
-    ba.append( getData( m_pos, maxSize ) );
-    m_pos += ba.count();
+    QMutexLocker lock( &m_mut );
 
-//    qDebug() << Q_FUNC_INFO << maxSize << ba.count() << 2;
-    memcpy( data, ba.data(), ba.count() );
+    // copy straight from the blocks into the caller's buffer
+    qint64 read = 0;
+    while ( read < maxSize && m_pos + read < m_size )
+    {
+        const int block = blockForPos( m_pos + read );
+        const int offset = offsetForPos( m_pos + read );
+        if ( block >= m_receivedBlocks.size() || !m_receivedBlocks.testBit( block ) )
+            break;
 
-    return ba.count();
+        qint64 len;
+        QMap< int, QByteArray >::const_iterator it = m_buffer.constFind( block );
+        if ( it != m_buffer.constEnd() )
+        {
+            len = qMin( (qint64)it.value().size() - offset, maxSize - read );
+            if ( len <= 0 )
+                break;
+
+            memcpy( data + read, it.value().constData() + offset, len );
+        }
+        else
+        {
+            len = qMin( (qint64)m_spilled.value( block ) - offset, maxSize - read );
+            if ( len <= 0 || !m_spillFile->seek( (qint64)block * BLOCKSIZE + offset ) )
+                break;
+
+            len = m_spillFile->read( data + read, len );
+            if ( len <= 0 )
+                break;
+        }
+
+        read += len;
+    }
+
+    m_pos += read;
+
+//    qDebug() << Q_FUNC_INFO << maxSize << read << 2;
+    return read;
 }
 
 
@@ -182,6 +288,10 @@ BufferIODevice::clear()
 
     m_pos = 0;
     m_buffer.clear();
+    m_spilled.clear();
+    m_receivedBlocks.fill( false );
+    m_firstEmpty = 0;
+    m_memory = 0;
 }
 
 
@@ -217,24 +327,25 @@ BufferIODevice::offsetForPos( qint64 pos ) const
 int
 BufferIODevice::nextEmptyBlock() const
 {
-    int i = 0;
-    foreach( const QByteArray& ba, m_buffer )
-    {
-        if ( ba.isEmpty() )
-            return i;
-
-        i++;
-    }
+    QMutexLocker lock( &m_mut );
 
-    if ( i == maxBlocks() )
+    if ( m_firstEmpty >= blockCount() )
         return -1;
 
-    return i;
+    return m_firstEmpty;
 }
 
 
 int
 BufferIODevice::maxBlocks() const
+{
+    QMutexLocker lock( &m_mut );
+    return blockCount();
+}
+
+
+int
+BufferIODevice::blockCount() const
 {
     int i = m_size / BLOCKSIZE;
 
@@ -248,33 +359,18 @@ BufferIODevice::maxBlocks() const
 bool
 BufferIODevice::isBlockEmpty( int block ) const
 {
-    if ( block >= m_buffer.count() )
+    QMutexLocker lock( &m_mut );
+
+    if ( block >= m_receivedBlocks.size() )
         return true;
 
-    return m_buffer.at( block ).isEmpty();
+    return !m_receivedBlocks.testBit( block );
 }
 
 
 QByteArray
-BufferIODevice::getData( qint64 pos, qint64 size )
+BufferIODevice::blockData( int block ) const
 {
-//    qDebug() << Q_FUNC_INFO << pos << size << 1;
-    QByteArray ba;
-    int block = blockForPos( pos );
-    int offset = offsetForPos( pos );
-
     QMutexLocker lock( &m_mut );
-    while( ba.count() < size )
-    {
-        if ( block > maxBlocks() )
-            break;
-
-        if ( isBlockEmpty( block ) )
-            break;
-
-        ba.append( m_buffer.at( block++ ).mid( offset ) );
-    }
-
-//    qDebug() << Q_FUNC_INFO << pos << size << 2;
-    return ba.left( size );
+    return m_buffer.value( block );
 }
@@ -22,13 +22,25 @@
 #include <QIODevice>
 #include <QMutexLocker>
 #include <QFile>
+#include <QBitArray>
+#include <QMap>
+#include <QHash>
 
+class QTemporaryFile;
+
+/**
+ * Receives a remote track in blocks, possibly out of order when seeking.
+ * Which blocks arrived is kept in a bitmap. Only a bounded amount of data stays
+ * in memory, the blocks farthest from the read position get spilled to a
+ * temporary file and are read back from there.
+ */
 class BufferIODevice : public QIODevice
 {
 Q_OBJECT
 
 public:
     explicit BufferIODevice( unsigned int size = 0, QObject* parent = 0 );
+    virtual ~BufferIODevice();
 
     virtual bool open( OpenMode mode );
     virtual void close();
@@ -56,6 +68,9 @@ public:
     int nextEmptyBlock() const;
     bool isBlockEmpty( int block ) const;
 
+    /// the data of a block still held in memory, shared rather than copied. Empty otherwise
+    QByteArray blockData( int block ) const;
+
 signals:
     void blockRequest( int block );
 
@@ -66,9 +81,18 @@ protected:
 private:
     int blockForPos( qint64 pos ) const;
     int offsetForPos( qint64 pos ) const;
-    QByteArray getData( qint64 pos, qint64 size );
+    int blockCount() const;
+    void spillBlocks();
+
+    QMap< int, QByteArray > m_buffer; // blocks held in memory
+    QBitArray m_receivedBlocks;       // blocks we have, in memory or spilled
+    QHash< int, int > m_spilled;      // block -> size, for blocks in the spill file
+    int m_firstEmpty;                 // no block below this one is missing
+    qint64 m_memory;
+
+    QTemporaryFile* m_spillFile;
+    bool m_spillFailed;
 
-    QList<QByteArray> m_buffer;
     mutable QMutex m_mut; //const methods need to lock
     unsigned int m_size, m_received;
 
@@ -26,9 +26,11 @@
 #include "utils/logger.h"
 
 #define PROTOVER "4" // must match remote peer, or we can't talk.
+// max bytes of complete msgs read per wakeup, before giving the event loop a go again
+#define READ_BATCH_SIZE ( 256 * 1024 )
 
 
-Connection::Connection( Servent* parent )
+Connection::Connection( Servent* parent, QThread* thread )
     : QObject()
     , m_sock( 0 )
     , m_peerport( 0 )
@@ -42,14 +44,17 @@ Connection::Connection( Servent* parent )
     , m_tx_bytes_requested( 0 )
     , m_rx_bytes( 0 )
     , m_id( "Connection()" )
+    , m_thread( thread ? thread : parent->thread() )
     , m_statstimer( 0 )
     , m_stats_tx_bytes_per_sec( 0 )
     , m_stats_rx_bytes_per_sec( 0 )
     , m_rx_bytes_last( 0 )
     , m_tx_bytes_last( 0 )
 {
-    moveToThread( m_servent->thread() );
-    qDebug() << "CTOR Connection (super)" << thread();
+    moveToThread( m_thread );
+    m_msgprocessor_in.moveToThread( m_thread );
+    m_msgprocessor_out.moveToThread( m_thread );
+    qDebug() << "CTOR Connection (super)" << this->thread();
 
     connect( &m_msgprocessor_out, SIGNAL( ready( msg_ptr ) ),
              SLOT( sendMsg_now( msg_ptr ) ), Qt::QueuedConnection );
@@ -240,15 +245,15 @@ Connection::doSetup()
     /*
         New connections can be created from other thread contexts, such as
         when AudioEngine calls getIODevice.. - we need to ensure that connections
-        and their associated sockets are running in the same thread as the servent.
+        and their associated sockets are running in the thread they were made for,
+        the servent's or one of its network threads.
 
         HINT: export QT_FATAL_WARNINGS=1 helps to catch these kind of errors.
      */
-    if( QThread::currentThread() != m_servent->thread() )
+    if( QThread::currentThread() != m_thread )
     {
-        // Connections should always be in the same thread as the servent.
         qDebug() << "Fixing thead affinity...";
-        moveToThread( m_servent->thread() );
+        moveToThread( m_thread );
         qDebug() << Q_FUNC_INFO  << thread();
     }
 
@@ -348,39 +353,51 @@ Connection::readyRead()
 {
 //    qDebug() << "readyRead, bytesavail:" << m_sock->bytesAvailable();
 
-    if( m_msg.isNull() )
+    if( m_sock.isNull() )
+        return;
+
+    // drain all complete msgs we have, up to a limit so others get a turn too
+    qint64 batch = 0;
+    while( batch < READ_BATCH_SIZE )
     {
-        if( m_sock->bytesAvailable() < Msg::headerSize() )
+        if( m_msg.isNull() )
+        {
+            if( m_sock->bytesAvailable() < Msg::headerSize() )
+                return;
+
+            char msgheader[ Msg::headerSize() ];
+            if( m_sock->read( (char*) &msgheader, Msg::headerSize() ) != Msg::headerSize() )
+            {
+                qDebug() << "Failed reading msg header";
+                this->markAsFailed();
+                return;
+            }
+
+            m_msg = Msg::begin( (char*) &msgheader );
+            m_rx_bytes += Msg::headerSize();
+        }
+
+        if( m_sock->bytesAvailable() < m_msg->length() )
             return;
 
-        char msgheader[ Msg::headerSize() ];
-        if( m_sock->read( (char*) &msgheader, Msg::headerSize() ) != Msg::headerSize() )
+        QByteArray ba = m_sock->read( m_msg->length() );
+        if( ba.length() != (qint32)m_msg->length() )
         {
-            qDebug() << "Failed reading msg header";
+            qDebug() << "Failed to read full msg payload";
             this->markAsFailed();
             return;
         }
+        m_msg->fill( ba );
+        m_rx_bytes += ba.length();
+        batch += Msg::headerSize() + ba.length();
 
-        m_msg = Msg::begin( (char*) &msgheader );
-        m_rx_bytes += Msg::headerSize();
-    }
-
-    if( m_sock->bytesAvailable() < m_msg->length() )
-        return;
+        handleReadMsg(); // process m_msg and clear() it
 
-    QByteArray ba = m_sock->read( m_msg->length() );
-    if( ba.length() != (qint32)m_msg->length() )
-    {
-        qDebug() << "Failed to read full msg payload";
-        this->markAsFailed();
-        return;
+        if( m_sock.isNull() )
+            return;
     }
-    m_msg->fill( ba );
-    m_rx_bytes += ba.length();
 
-    handleReadMsg(); // process m_msg and clear() it
-
-    // since there is no explicit threading, use the event loop to schedule this:
+    // more to read than one batch, use the event loop to schedule the rest:
     if( m_sock->bytesAvailable() )
     {
         QTimer::singleShot( 0, this, SLOT( readyRead() ) );
@@ -468,6 +485,9 @@ Connection::sendMsg_now( msg_ptr msg )
         return;
     }
 
+    // sendMsg() accounted for the msg as it was, the msgprocessor may have compressed it since
+    m_tx_bytes_requested += (qint64)msg->length() - (qint64)msg->originalLength();
+
     if ( !msg->write( m_sock.data() ) )
     {
         //qDebug() << "Error writing to socket in sendMsg() *************";
@@ -483,7 +503,12 @@ Connection::bytesWritten( qint64 i )
     m_tx_bytes += i;
     // if we are waiting to shutdown, and have sent all queued data, do actual shutdown:
     if ( m_do_shutdown && m_tx_bytes == m_tx_bytes_requested )
+    {
         actualShutdown();
+        return;
+    }
+
+    emit sendProgress( i );
 }
 
 
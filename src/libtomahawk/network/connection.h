@@ -50,7 +50,8 @@ Q_OBJECT
 
 public:
 
-    Connection( Servent* parent );
+    /// the connection and its socket live in thread, or in the servent's thread if none is given
+    Connection( Servent* parent, QThread* thread = 0 );
     virtual ~Connection();
     virtual Connection* clone() = 0;
 
@@ -84,6 +85,8 @@ public:
     bool isRunning() const { return m_sock != 0; }
 
     qint64 bytesSent() const { return m_tx_bytes; }
+    /// bytes handed to sendMsg() that did not make it onto the wire yet, including those still in the msgprocessor
+    qint64 bytesPending() const { return m_tx_bytes_requested - m_tx_bytes; }
     qint64 bytesReceived() const { return m_rx_bytes; }
 
     void setMsgProcessorModeOut( quint32 m ) { m_msgprocessor_out.setMode( m ); }
@@ -96,6 +99,8 @@ signals:
     void failed();
     void finished();
     void statsTick( qint64 tx_bytes_sec, qint64 rx_bytes_sec );
+    /// bytes were written out to the socket, there might be room for more
+    void sendProgress( qint64 bytes );
     void socketClosed();
     void socketErrored( QAbstractSocket::SocketError );
 
@@ -143,6 +148,7 @@ private:
     qint64 m_tx_bytes, m_tx_bytes_requested;
     qint64 m_rx_bytes;
     QString m_id;
+    QThread* m_thread;
 
     QTimer* m_statstimer;
     QTime m_statstimer_mark;
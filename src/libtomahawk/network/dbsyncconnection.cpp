@@ -21,9 +21,12 @@
     Database syncing using the oplog table.
     =======================================
     Load the last GUID we applied for the peer, tell them it.
-    In return, they send us all new ops since that guid.
+    In return, they send us a page of new ops since that guid.
 
-    We then apply those new ops to our cache of their data
+    We then apply those new ops to our cache of their data, and ask
+    again for the ops following the last one we applied. This repeats
+    until they reply with "ok", so an interrupted sync resumes from
+    the last applied op.
 
     Synced.
 
@@ -40,6 +43,11 @@
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// max number of ops loaded and sent in one go, before the peer asks for more
+#define SYNC_PAGE_SIZE 1000
+// max bytes queued on the socket while sending a page
+#define SYNC_WINDOW_SIZE ( 256 * 1024 )
+
 using namespace Tomahawk;
 
 
@@ -54,6 +62,7 @@ DBSyncConnection::DBSyncConnection( Servent* s, const source_ptr& src )
              m_source.data(),   SLOT( onStateChanged( DBSyncConnection::State, DBSyncConnection::State, QString ) ) );
     connect( m_source.data(), SIGNAL( commandsFinished() ),
              this,              SLOT( lastOpApplied() ) );
+    connect( this, SIGNAL( sendProgress( qint64 ) ), SLOT( sendMoreOps() ) );
 
     this->setMsgProcessorModeIn( MsgProcessor::PARSE_JSON | MsgProcessor::UNCOMPRESS_ALL );
 
@@ -259,7 +268,7 @@ DBSyncConnection::sendOps()
 
     source_ptr src = SourceList::instance()->getLocal();
 
-    DatabaseCommand_loadOps* cmd = new DatabaseCommand_loadOps( src, m_uscache.value( "lastop" ).toString() );
+    DatabaseCommand_loadOps* cmd = new DatabaseCommand_loadOps( src, m_uscache.value( "lastop" ).toString(), SYNC_PAGE_SIZE );
     connect( cmd, SIGNAL( done( QString, QString, QList< dbop_ptr > ) ),
                     SLOT( sendOpsData( QString, QString, QList< dbop_ptr > ) ) );
 
@@ -283,17 +292,30 @@ DBSyncConnection::sendOpsData( QString sinceguid, QString lastguid, QList< dbop_
 
     tLog( LOGVERBOSE ) << Q_FUNC_INFO << sinceguid << lastguid << "Num ops to send:" << ops.length();
 
-    int i;
-    for( i = 0; i < ops.length(); ++i )
+    m_sendQueue = ops;
+    sendMoreOps();
+}
+
+
+void
+DBSyncConnection::sendMoreOps()
+{
+    if ( m_sendQueue.isEmpty() || !isRunning() )
+        return;
+
+    // keep at most a window of ops between us and the wire, counting what still sits in the
+    // msgprocessor too, instead of buffering the whole page. sendProgress() brings us back
+    while ( !m_sendQueue.isEmpty() && bytesPending() < SYNC_WINDOW_SIZE )
     {
+        dbop_ptr op = m_sendQueue.takeFirst();
         quint8 flags = Msg::JSON | Msg::DBOP;
 
-        if ( ops.at( i )->compressed )
+        if ( op->compressed )
             flags |= Msg::COMPRESSED;
-        if ( i != ops.length() - 1 )
+        if ( !m_sendQueue.isEmpty() ) // the last op ends the page
             flags |= Msg::FRAGMENT;
 
-        sendMsg( Msg::factory( ops.at( i )->payload, flags ) );
+        sendMsg( Msg::factory( op->payload, flags ) );
     }
 }
 
@@ -70,6 +70,7 @@ private slots:
 
     void fetchOpsData( const QString& sinceguid );
     void sendOpsData( QString sinceguid, QString lastguid, QList< dbop_ptr > ops );
+    void sendMoreOps();
     void lastOpApplied();
 
     void check();
@@ -83,6 +84,9 @@ private:
 
     QString m_lastSentOp;
 
+    // the page of ops currently being sent, written out as the socket drains
+    QList< dbop_ptr > m_sendQueue;
+
     State m_state;
 };
 
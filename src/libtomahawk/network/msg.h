@@ -102,6 +102,8 @@ public:
     static quint8 headerSize() { return sizeof(quint32) + sizeof(quint8); }
 
     quint32 length() const { return m_length; }
+    /// length of the payload as it was constructed, before the MsgProcessor (un)compressed it
+    quint32 originalLength() const { return m_originalLength; }
 
     bool is( Flag flag ) { return m_flags & flag; }
 
@@ -133,6 +135,7 @@ private:
     Msg( const QByteArray& ba, char f )
         :   m_payload( ba ),
             m_length( ba.length() ),
+            m_originalLength( ba.length() ),
             m_flags( f ),
             m_incomplete( false ),
             m_json_parsed( false)
@@ -142,6 +145,7 @@ private:
     /// used when constructung Msg off the wire:
     Msg( quint32 len, quint8 flags )
         :   m_length( len ),
+            m_originalLength( len ),
             m_flags( flags ),
             m_incomplete( true ),
             m_json_parsed( false)
@@ -150,6 +154,7 @@ private:
 
     QByteArray m_payload;
     quint32 m_length;
+    quint32 m_originalLength;
     char m_flags;
     bool m_incomplete;
     QVariant m_json;
@@ -25,7 +25,7 @@
 MsgProcessor::MsgProcessor( quint32 mode, quint32 t ) :
     QObject(), m_mode( mode ), m_threshold( t ), m_totmsgsize( 0 )
 {
-    moveToThread( Servent::instance()->thread() );
+    // our Connection moves us into its own thread
 }
 
 
@@ -59,10 +59,17 @@ Servent::Servent( QObject* parent )
     , m_port( 0 )
     , m_externalPort( 0 )
     , m_ready( false )
+    , m_peerUploadRate( 0 )
     , m_portfwd( 0 )
 {
     s_instance = this;
 
+    m_ioThread = new QThread( this );
+    m_ioThread->start();
+
+    onSettingsChanged();
+    connect( TomahawkSettings::instance(), SIGNAL( changed() ), SLOT( onSettingsChanged() ) );
+
     m_lanHack = qApp->arguments().contains( "--lanhack" );
     ACLRegistry::instance();
     setProxy( QNetworkProxy::NoProxy );
@@ -91,6 +98,32 @@ Servent::~Servent()
 {
     delete ACLRegistry::instance();
     delete m_portfwd;
+
+    m_ioThread->quit();
+    m_ioThread->wait();
+}
+
+
+void
+Servent::onSettingsChanged()
+{
+    m_uploadBucket.setRate( (qint64)TomahawkSettings::instance()->uploadRate() * 1024 );
+
+    QMutexLocker lock( &m_uploadBucketsMutex );
+    m_peerUploadRate = (qint64)TomahawkSettings::instance()->peerUploadRate() * 1024;
+    foreach ( const QSharedPointer< TokenBucket >& bucket, m_peerUploadBuckets )
+        bucket->setRate( m_peerUploadRate );
+}
+
+
+QSharedPointer< TokenBucket >
+Servent::peerUploadBucket( const QString& peer )
+{
+    QMutexLocker lock( &m_uploadBucketsMutex );
+    if ( !m_peerUploadBuckets.contains( peer ) )
+        m_peerUploadBuckets.insert( peer, QSharedPointer< TokenBucket >( new TokenBucket( m_peerUploadRate ) ) );
+
+    return m_peerUploadBuckets.value( peer );
 }
 
 
@@ -483,6 +516,10 @@ void Servent::handoverSocket( Connection* conn, QTcpSocketExtra* sock )
     conn->setOutbound( sock->_outbound );
     conn->setPeerPort( sock->peerPort() );
 
+    // the connection owns the socket from now on, so it has to live in the same thread
+    if ( sock->thread() != conn->thread() )
+        sock->moveToThread( conn->thread() );
+
     conn->start( sock );
 }
 
@@ -25,10 +25,12 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QTimer>
 #include <QtCore/QPointer>
+#include <QtCore/QThread>
 #include <QtNetwork/QTcpServer>
 #include <QtNetwork/QTcpSocket>
 #include <QtNetwork/QHostInfo>
@@ -39,6 +41,7 @@
 
 #include "typedefs.h"
 #include "msg.h"
+#include "tokenbucket.h"
 
 #include <boost/function.hpp>
 
@@ -119,6 +122,13 @@ public:
 
     QList< StreamConnection* > streams() const { return m_scsessions; }
 
+    // upload rate caps shared by all streams, and by all streams to one peer
+    TokenBucket* uploadBucket() { return &m_uploadBucket; }
+    QSharedPointer< TokenBucket > peerUploadBucket( const QString& peer );
+
+    // thread running the bulk data connections, so they don't compete with the GUI
+    QThread* ioThread() const { return m_ioThread; }
+
     QSharedPointer< QIODevice > getIODeviceForUrl( const Tomahawk::result_ptr& result );
     void registerIODeviceFactory( const QString &proto, boost::function< QSharedPointer< QIODevice >(Tomahawk::result_ptr) > fac );
     QSharedPointer< QIODevice > localFileIODeviceFactory( const Tomahawk::result_ptr& result );
@@ -149,6 +159,7 @@ public slots:
 
 private slots:
     void readyRead();
+    void onSettingsChanged();
 
     Connection* claimOffer( ControlConnection* cc, const QString &nodeid, const QString &key, const QHostAddress peer = QHostAddress::Any );
 
@@ -172,6 +183,13 @@ private:
     QList< StreamConnection* > m_scsessions;
     QMutex m_ftsession_mut;
 
+    TokenBucket m_uploadBucket;
+    QHash< QString, QSharedPointer< TokenBucket > > m_peerUploadBuckets;
+    QMutex m_uploadBucketsMutex;
+    qint64 m_peerUploadRate;
+
+    QThread* m_ioThread;
+
     QMap< QString,boost::function< QSharedPointer< QIODevice >(Tomahawk::result_ptr) > > m_iofactories;
 
     PortFwdThread* m_portfwd;
@@ -20,22 +20,27 @@
 #include "streamconnection.h"
 
 #include <QFile>
+#include <QTimer>
 
 #include "result.h"
 
 #include "bufferiodevice.h"
 #include "network/controlconnection.h"
 #include "network/servent.h"
+#include "network/tokenbucket.h"
 #include "database/databasecommand_loadfiles.h"
 #include "database/database.h"
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// stop handing frames to the socket while this much is waiting to be written
+#define STREAM_HIGH_WATER ( 256 * 1024 )
+
 using namespace Tomahawk;
 
 
 StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString fid, const Tomahawk::result_ptr& result )
-    : Connection( s )
+    : Connection( s, s->ioThread() )
     , m_cc( cc )
     , m_fid( fid )
     , m_type( RECEIVING )
@@ -43,6 +48,8 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     , m_badded( 0 )
     , m_bsent( 0 )
     , m_allok( false )
+    , m_eofSent( false )
+    , m_throttled( false )
     , m_result( result )
     , m_transferRate( 0 )
 {
@@ -69,18 +76,23 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
 
 
 StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString fid )
-    : Connection( s )
+    : Connection( s, s->ioThread() )
     , m_cc( cc )
     , m_fid( fid )
     , m_type( SENDING )
     , m_badded( 0 )
     , m_bsent( 0 )
     , m_allok( false )
+    , m_eofSent( false )
+    , m_throttled( false )
     , m_transferRate( 0 )
 {
     Servent::instance()->registerStreamConnection( this );
     // auto delete when connection closes:
     connect( this, SIGNAL( finished() ), SLOT( deleteLater() ), Qt::QueuedConnection );
+
+    // resume sending whenever the socket drained some data, or once the rate caps allow it
+    connect( this, SIGNAL( sendProgress( qint64 ) ), SLOT( sendSome() ) );
 }
 
 
@@ -128,7 +140,14 @@ StreamConnection::showStats( qint64 tx, qint64 rx )
     }
 
     m_transferRate = tx + rx;
-    emit updated();
+    emitUpdated();
+}
+
+
+void
+StreamConnection::emitUpdated()
+{
+    emit updated( m_transferRate, m_result, m_source, m_type );
 }
 
 
@@ -153,7 +172,7 @@ StreamConnection::setup()
     if( m_type == RECEIVING )
     {
         qDebug() << "in RX mode";
-        emit updated();
+        emitUpdated();
         return;
     }
 
@@ -187,9 +206,17 @@ StreamConnection::startSending( const Tomahawk::result_ptr& result )
     }
 
     m_readdev = QSharedPointer<QIODevice>( io );
+
+    QString peer;
+    if ( !m_source.isNull() )
+        peer = m_source->userName();
+    else if ( isRunning() )
+        peer = socket()->peerAddress().toString();
+    m_peerBucket = Servent::instance()->peerUploadBucket( peer );
+
     sendSome();
 
-    emit updated();
+    emitUpdated();
 }
 
 
@@ -204,6 +231,7 @@ StreamConnection::handleMsg( msg_ptr msg )
         m_readdev->seek( block * BufferIODevice::blockSize() );
 
         qDebug() << "Seeked to block:" << block;
+        m_eofSent = false;
 
         QByteArray sm;
         sm.append( QString( "doneblock%1" ).arg( block ) );
@@ -221,8 +249,18 @@ StreamConnection::handleMsg( msg_ptr msg )
     }
     else if ( msg->payload().startsWith( "data" ) )
     {
-        m_badded += msg->payload().length() - 4;
-        ((BufferIODevice*)m_iodev.data())->addData( m_curBlock++, msg->payload().mid( 4 ) );
+        // a frame may carry several blocks, split it up again
+        const QByteArray& payload = msg->payload();
+        const int blockSize = BufferIODevice::blockSize();
+        m_badded += payload.length() - 4;
+
+        int pos = 4;
+        do
+        {
+            ((BufferIODevice*)m_iodev.data())->addData( m_curBlock++, payload.mid( pos, blockSize ) );
+            pos += blockSize;
+        }
+        while ( pos < payload.length() );
     }
 
     //qDebug() << Q_FUNC_INFO << "flags" << (int) msg->flags()
@@ -247,29 +285,71 @@ StreamConnection::clone()
 }
 
 
+void
+StreamConnection::onThrottleTimeout()
+{
+    m_throttled = false;
+    sendSome();
+}
+
+
 void
 StreamConnection::sendSome()
 {
     Q_ASSERT( m_type == StreamConnection::SENDING );
 
-    QByteArray ba = "data";
-    ba.append( m_readdev->read( BufferIODevice::blockSize() ) );
-    m_bsent += ba.length() - 4;
-
-    if( m_readdev->atEnd() )
-    {
-        sendMsg( Msg::factory( ba, Msg::RAW ) );
+    // throttled, the timer brings us back
+    if ( m_readdev.isNull() || !isRunning() || m_throttled )
         return;
-    }
-    else
+
+    // frames stay one block big, that's what older peers expect
+    const int frameSize = BufferIODevice::blockSize();
+    TokenBucket* uploadBucket = Servent::instance()->uploadBucket();
+
+    qint64 queued = 0;
+    while ( !m_eofSent )
     {
-        // more to come -> FRAGMENT
-        sendMsg( Msg::factory( ba, Msg::RAW | Msg::FRAGMENT ) );
-    }
+        // wait for the socket to drain, sendProgress() brings us back
+        if ( socket()->bytesToWrite() + queued >= STREAM_HIGH_WATER )
+            return;
 
-    // HINT: change the 0 to 50 to transmit at 640Kbps, for example
-    //       (this is where upload throttling could be implemented)
-    QTimer::singleShot( 0, this, SLOT( sendSome() ) );
+        const int wait = qMax( uploadBucket->msecsUntil( frameSize ), m_peerBucket->msecsUntil( frameSize ) );
+        if ( wait > 0 )
+        {
+            // single shot from the io thread we run in, a timer member would live on the thread that constructed us
+            m_throttled = true;
+            QTimer::singleShot( wait, this, SLOT( onThrottleTimeout() ) );
+            return;
+        }
+        uploadBucket->take( frameSize );
+        m_peerBucket->take( frameSize );
+
+        // read straight into the frame, behind its prefix
+        QByteArray ba;
+        ba.resize( 4 + frameSize );
+        memcpy( ba.data(), "data", 4 );
+        const qint64 len = m_readdev->read( ba.data() + 4, frameSize );
+        if ( len < 0 )
+        {
+            qDebug() << "Failed reading from source:" << m_result->url();
+            shutdown();
+            return;
+        }
+        ba.resize( 4 + len );
+        m_bsent += len;
+        queued += ba.length();
+
+        if ( m_readdev->atEnd() )
+        {
+            m_eofSent = true;
+            sendMsg( Msg::factory( ba, Msg::RAW ) );
+        }
+        else
+        {
+            // more to come -> FRAGMENT
+            sendMsg( Msg::factory( ba, Msg::RAW | Msg::FRAGMENT ) );
+        }
+    }
 }
 
 
@@ -31,6 +31,7 @@
 
 class ControlConnection;
 class BufferIODevice;
+class TokenBucket;
 
 class DLLEXPORT StreamConnection : public Connection
 {
@@ -65,7 +66,8 @@ public:
     QString fid() const { return m_fid; }
 
 signals:
-    void updated();
+    /// carries the state, receivers in other threads must not call back into us: we may be gone by then
+    void updated( qint64 transferRate, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, int type );
 
 protected slots:
     virtual void handleMsg( msg_ptr msg );
@@ -73,11 +75,14 @@ protected slots:
 private slots:
     void startSending( const Tomahawk::result_ptr& );
     void sendSome();
+    void onThrottleTimeout();
     void showStats( qint64 tx, qint64 rx );
 
     void onBlockRequest( int pos );
 
 private:
+    void emitUpdated();
+
     QSharedPointer<QIODevice> m_iodev;
     ControlConnection* m_cc;
     QString m_fid;
@@ -88,6 +93,10 @@ private:
 
     int m_badded, m_bsent;
     bool m_allok; // got last msg ok, transfer complete?
+    bool m_eofSent;
+
+    QSharedPointer<TokenBucket> m_peerBucket;
+    bool m_throttled; // waiting on the rate caps, a single shot timer brings us back
 
     Tomahawk::source_ptr m_source;
     Tomahawk::result_ptr m_result;
@@ -0,0 +1,92 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenbucket.h"
+
+#include <QtCore/QMutexLocker>
+
+
+TokenBucket::TokenBucket( qint64 rate )
+    : m_rate( rate )
+    , m_tokens( rate )
+{
+    m_lastRefill.start();
+}
+
+
+qint64
+TokenBucket::rate() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_rate;
+}
+
+
+void
+TokenBucket::setRate( qint64 rate )
+{
+    QMutexLocker lock( &m_mutex );
+    m_rate = rate;
+    m_tokens = qMin( m_tokens, rate );
+}
+
+
+bool
+TokenBucket::take( qint64 bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( m_rate <= 0 )
+        return true;
+
+    refill();
+    // a single take bigger than the burst size would never succeed otherwise
+    if ( m_tokens < qMin( bytes, m_rate ) )
+        return false;
+
+    m_tokens -= bytes;
+    return true;
+}
+
+
+int
+TokenBucket::msecsUntil( qint64 bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( m_rate <= 0 )
+        return 0;
+
+    refill();
+    const qint64 missing = qMin( bytes, m_rate ) - m_tokens;
+    if ( missing <= 0 )
+        return 0;
+
+    return (int)( ( missing * 1000 + m_rate - 1 ) / m_rate );
+}
+
+
+void
+TokenBucket::refill()
+{
+    // only move the mark once we gained something, slow rates would starve otherwise
+    const qint64 gained = (qint64)m_lastRefill.elapsed() * m_rate / 1000;
+    if ( gained <= 0 )
+        return;
+
+    m_lastRefill.restart();
+    m_tokens = qMin( m_rate, m_tokens + gained );
+}
@@ -0,0 +1,53 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QTime>
+
+#include "dllmacro.h"
+
+/**
+ * Rate limiter: tokens (bytes) refill at rate per second, up to one second's
+ * worth of burst. A rate of 0 means unlimited. Safe to share between threads.
+ */
+class DLLEXPORT TokenBucket
+{
+public:
+    explicit TokenBucket( qint64 rate = 0 );
+
+    qint64 rate() const;
+    void setRate( qint64 rate );
+
+    /// takes bytes tokens if that many are available right now
+    bool take( qint64 bytes );
+    /// ms until bytes tokens will be available, 0 if they are now
+    int msecsUntil( qint64 bytes );
+
+private:
+    void refill();
+
+    mutable QMutex m_mutex;
+    qint64 m_rate;
+    qint64 m_tokens;
+    QTime m_lastRefill;
+};
+
+#endif // TOKENBUCKET_H
@@ -19,8 +19,10 @@
 #include "pipeline.h"
 
 #include <QMutexLocker>
+#include <qmath.h>
 
 #include "functimeout.h"
+#include "tomahawksettings.h"
 #include "database/database.h"
 #include "ExternalResolver.h"
 #include "resolvers/scriptresolver.h"
@@ -32,14 +34,101 @@
 
 #define DEFAULT_CONCURRENT_QUERIES 4
 #define MAX_CONCURRENT_QUERIES 16
+// extra slots only interactive and next-up queries may use, so they never wait for a full pipeline
+#define RESERVED_CONCURRENT_QUERIES 2
+// a priority class that didn't get a slot for this long goes first once, so the background can't starve
+#define PRIORITY_AGING_TIMEOUT 3000
 #define CLEANUP_TIMEOUT 5 * 60 * 1000
 #define MINSCORE 0.5
 
+// wait this long for more index / resolver changes before re-resolving live queries
+#define REFRESH_COALESCE_DELAY 1000
+#define REFRESH_INTERVAL 100
+// don't add refreshes while this many queries are waiting in the pipeline already
+#define REFRESH_MAX_PENDING 500
+
+// reply times are kept in buckets growing by 25% each, from 10ms to about a minute
+#define LATENCY_BUCKETS 40
+#define LATENCY_MIN_SAMPLES 20
+// older samples count half once this many were collected, so the stats follow changes
+#define LATENCY_DECAY_SAMPLES 500
+// adaptive timeouts are this percentile of the reply times plus a margin, at most the resolver's own timeout
+#define TIMEOUT_PERCENTILE 0.95
+#define TIMEOUT_MIN_MARGIN 500
+#define TIMEOUT_MIN 1000
+// a query still unsolved after this percentile of its resolver's reply times goes to the next resolver, too
+#define SPECULATE_PERCENTILE 0.75
+#define SPECULATE_MIN 250
+
 using namespace Tomahawk;
 
 Pipeline* Pipeline::s_instance = 0;
 
 
+struct Pipeline::ResolverStats
+{
+    ResolverStats()
+        : samples( 0 )
+        , replies( 0 )
+        , hits( 0 )
+        , timeouts( 0 )
+    {
+        for ( int i = 0; i < LATENCY_BUCKETS; i++ )
+            buckets[ i ] = 0;
+    }
+
+    static int bound( int bucket )
+    {
+        return (int)( 10 * qPow( 1.25, bucket ) );
+    }
+
+    void add( int latency )
+    {
+        int bucket = 0;
+        while ( bucket < LATENCY_BUCKETS - 1 && bound( bucket ) < latency )
+            bucket++;
+
+        buckets[ bucket ]++;
+        if ( ++samples < LATENCY_DECAY_SAMPLES )
+            return;
+
+        samples = 0;
+        for ( int i = 0; i < LATENCY_BUCKETS; i++ )
+        {
+            buckets[ i ] /= 2;
+            samples += buckets[ i ];
+        }
+        replies /= 2;
+        hits /= 2;
+        timeouts /= 2;
+    }
+
+    // upper bound of the reply time p of all samples stayed below, -1 if there aren't enough samples yet
+    int percentile( float p ) const
+    {
+        if ( samples < LATENCY_MIN_SAMPLES )
+            return -1;
+
+        const unsigned int rank = (unsigned int)qCeil( p * samples );
+        unsigned int count = 0;
+        for ( int i = 0; i < LATENCY_BUCKETS; i++ )
+        {
+            count += buckets[ i ];
+            if ( count >= rank )
+                return bound( i );
+        }
+
+        return bound( LATENCY_BUCKETS - 1 );
+    }
+
+    unsigned int buckets[ LATENCY_BUCKETS ];
+    unsigned int samples;
+    unsigned int replies;
+    unsigned int hits;
+    unsigned int timeouts;
+};
+
+
 Pipeline*
 Pipeline::instance()
 {
@@ -50,14 +139,25 @@ Pipeline::instance()
 Pipeline::Pipeline( QObject* parent )
     : QObject( parent )
     , m_running( false )
+    , m_refreshTriggers( 0 )
 {
     s_instance = this;
 
     m_maxConcurrentQueries = qBound( DEFAULT_CONCURRENT_QUERIES, QThread::idealThreadCount(), MAX_CONCURRENT_QUERIES );
     tDebug() << Q_FUNC_INFO << "Using" << m_maxConcurrentQueries << "threads";
 
+    for ( int i = 0; i < PriorityCount; i++ )
+        m_activeCount[ i ] = 0;
+
     m_temporaryQueryTimer.setInterval( CLEANUP_TIMEOUT );
     connect( &m_temporaryQueryTimer, SIGNAL( timeout() ), SLOT( onTemporaryQueryTimer() ) );
+
+    m_refreshCoalesceTimer.setSingleShot( true );
+    m_refreshCoalesceTimer.setInterval( REFRESH_COALESCE_DELAY );
+    connect( &m_refreshCoalesceTimer, SIGNAL( timeout() ), SLOT( startRefresh() ) );
+
+    m_refreshTimer.setInterval( REFRESH_INTERVAL );
+    connect( &m_refreshTimer, SIGNAL( timeout() ), SLOT( refreshNext() ) );
 }
 
 
@@ -72,6 +172,11 @@ Pipeline::~Pipeline()
             r.data()->deleteLater();
 
     m_scriptResolvers.clear();
+
+    qDeleteAll( m_resolverStats );
+
+    // queries might outlive us
+    s_instance = 0;
 }
 
 
@@ -79,6 +184,7 @@ void
 Pipeline::databaseReady()
 {
     connect( Database::instance(), SIGNAL( indexReady() ), this, SLOT( start() ), Qt::QueuedConnection );
+    connect( Database::instance(), SIGNAL( indexReady() ), this, SLOT( onIndexChanged() ), Qt::QueuedConnection );
     Database::instance()->loadIndex();
 }
 
@@ -86,7 +192,7 @@ Pipeline::databaseReady()
 void
 Pipeline::start()
 {
-    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << m_queries_pending.size();
+    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << pendingQueryCount();
     m_running = true;
 
     shuntNext();
@@ -103,21 +209,191 @@ Pipeline::stop()
 void
 Pipeline::removeResolver( Resolver* r )
 {
-    QMutexLocker lock( &m_mut );
+    // queries still waiting for r won't get an answer from it anymore
+    QList< query_ptr > waiting;
+    {
+        QMutexLocker lock( &m_mut );
+
+        m_resolvers.removeAll( r );
+        delete m_resolverStats.take( r );
 
-    m_resolvers.removeAll( r );
-    emit resolverRemoved( r );
+        QHashIterator< QID, QHash< Resolver*, QTime > > it( m_qidsDispatched );
+        while ( it.hasNext() )
+        {
+            it.next();
+            if ( it.value().contains( r ) && m_qids.contains( it.key() ) )
+                waiting << m_qids.value( it.key() );
+        }
+
+        emit resolverRemoved( r );
+    }
+
+    foreach ( const query_ptr& q, waiting )
+        decQIDState( q, r );
+
+    scheduleRefresh( ResolversChanged );
+}
+
+
+unsigned int
+Pipeline::currentTimeout( Resolver* r )
+{
+    QMutexLocker lock( &m_mut );
+    return resolverTimeout( r );
 }
 
 
 void
 Pipeline::addResolver( Resolver* r )
 {
-    QMutexLocker lock( &m_mut );
+    {
+        QMutexLocker lock( &m_mut );
+
+        tDebug() << "Adding resolver" << r->name();
+        m_resolvers.append( r );
+        emit resolverAdded( r );
+    }
+
+    scheduleRefresh( ResolversChanged );
+}
+
+
+void
+Pipeline::registerQuery( const query_ptr& q, bool refreshOnIndexChange )
+{
+    QMutexLocker lock( &m_refreshMutex );
+
+    m_liveQueries.insert( q.data(), q.toWeakRef() );
+    if ( refreshOnIndexChange )
+        m_indexRefreshQueries.insert( q.data() );
+}
+
+
+void
+Pipeline::unregisterQuery( Query* q )
+{
+    QMutexLocker lock( &m_refreshMutex );
+
+    m_liveQueries.remove( q );
+    m_indexRefreshQueries.remove( q );
+    m_refreshQueued.remove( q );
+}
+
+
+void
+Pipeline::prioritizeRefresh( const QList< query_ptr >& queries )
+{
+    QMutexLocker lock( &m_refreshMutex );
+
+    foreach ( const query_ptr& q, queries )
+    {
+        if ( m_refreshQueued.contains( q.data() ) )
+            m_refreshPriorityQueue << q.toWeakRef();
+    }
+}
+
+
+void
+Pipeline::onIndexChanged()
+{
+    scheduleRefresh( IndexChanged );
+}
+
+
+void
+Pipeline::scheduleRefresh( int trigger )
+{
+    {
+        QMutexLocker lock( &m_refreshMutex );
+        m_refreshTriggers |= trigger;
+    }
+
+    // more changes usually follow, e.g. when many resolvers get loaded. collect them first
+    if ( !m_refreshCoalesceTimer.isActive() )
+        m_refreshCoalesceTimer.start();
+}
+
+
+void
+Pipeline::startRefresh()
+{
+    {
+        QMutexLocker lock( &m_refreshMutex );
+
+        const int triggers = m_refreshTriggers;
+        m_refreshTriggers = 0;
+
+        QHash< Query*, QWeakPointer< Query > >::const_iterator it = m_liveQueries.constBegin();
+        for ( ; it != m_liveQueries.constEnd(); ++it )
+        {
+            int queryTriggers = triggers & ResolversChanged;
+            if ( ( triggers & IndexChanged ) && m_indexRefreshQueries.contains( it.key() ) )
+                queryTriggers |= IndexChanged;
+            if ( !queryTriggers )
+                continue;
 
-    tDebug() << "Adding resolver" << r->name();
-    m_resolvers.append( r );
-    emit resolverAdded( r );
+            if ( m_refreshQueued.contains( it.key() ) )
+            {
+                m_refreshQueued[ it.key() ] |= queryTriggers;
+                continue;
+            }
+
+            m_refreshQueued.insert( it.key(), queryTriggers );
+            m_refreshQueue << it.value();
+        }
+
+        tDebug() << Q_FUNC_INFO << "Queries waiting to be refreshed:" << m_refreshQueued.count();
+    }
+
+    if ( !m_refreshTimer.isActive() )
+        m_refreshTimer.start();
+    refreshNext();
+}
+
+
+void
+Pipeline::refreshNext()
+{
+    if ( !m_running )
+        return;
+
+    // let the pipeline catch up first, refreshing is never urgent
+    if ( pendingQueryCount() > REFRESH_MAX_PENDING )
+        return;
+
+    int budget = qMax( 1, (int)( TomahawkSettings::instance()->resolveRefreshRate() * REFRESH_INTERVAL / 1000 ) );
+    while ( budget > 0 )
+    {
+        query_ptr q;
+        int triggers = 0;
+        {
+            QMutexLocker lock( &m_refreshMutex );
+
+            if ( m_refreshPriorityQueue.isEmpty() && m_refreshQueue.isEmpty() )
+            {
+                m_refreshTimer.stop();
+                return;
+            }
+
+            if ( !m_refreshPriorityQueue.isEmpty() )
+                q = m_refreshPriorityQueue.takeFirst().toStrongRef();
+            else
+                q = m_refreshQueue.takeFirst().toStrongRef();
+
+            if ( q.isNull() || !m_refreshQueued.contains( q.data() ) )
+                continue;
+
+            triggers = m_refreshQueued.take( q.data() );
+        }
+
+        // same conditions as before, when every query listened for these changes itself
+        if ( ( ( triggers & IndexChanged ) && q->resolvingFinished() ) ||
+             ( ( triggers & ResolversChanged ) && !q->isFullTextQuery() && !q->solved() ) )
+        {
+            q->refreshResults();
+            budget--;
+        }
+    }
 }
 
 
@@ -196,17 +472,32 @@ Pipeline::resolverForPath( const QString& scriptPath )
 
 
 void
-Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool temporaryQuery )
+Pipeline::resolve( const QList<query_ptr>& qlist, Priority priority, bool temporaryQuery )
 {
     {
         QMutexLocker lock( &m_mut );
 
-        int i = 0;
+        // queries waiting in a lower class move up
+        QSet< QID > moved;
+        foreach( const query_ptr& q, qlist )
+        {
+            if ( !q->resolvingFinished() && m_pendingPriority.value( q->id(), -1 ) > priority )
+                moved << q->id();
+        }
+        dequeue( moved );
+
+        QList< query_ptr > queued;
+        QSet< QID > added;
         foreach( const query_ptr& q, qlist )
         {
             if ( q->resolvingFinished() )
                 continue;
-            if ( m_queries_pending.contains( q ) )
+            if ( moved.remove( q->id() ) )
+            {
+                queued << q;
+                continue;
+            }
+            if ( m_pendingPriority.contains( q->id() ) || added.contains( q->id() ) )
                 continue;
             if ( m_qidsState.contains( q->id() ) )
                 continue;
@@ -214,10 +505,8 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
             if ( !m_qids.contains( q->id() ) )
                 m_qids.insert( q->id(), q );
 
-            if ( prioritized )
-                m_queries_pending.insert( i++, q );
-            else
-                m_queries_pending << q;
+            added << q->id();
+            queued << q;
 
             if ( temporaryQuery )
             {
@@ -228,6 +517,8 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
                 m_temporaryQueryTimer.start();
             }
         }
+
+        enqueue( queued, priority );
     }
 
     shuntNext();
@@ -235,26 +526,206 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
 
 
 void
-Pipeline::resolve( const query_ptr& q, bool prioritized, bool temporaryQuery )
+Pipeline::resolve( const query_ptr& q, Priority priority, bool temporaryQuery )
 {
     if ( q.isNull() )
         return;
 
     QList< query_ptr > qlist;
     qlist << q;
-    resolve( qlist, prioritized, temporaryQuery );
+    resolve( qlist, priority, temporaryQuery );
+}
+
+
+void
+Pipeline::resolve( QID qid, Priority priority, bool temporaryQuery )
+{
+    resolve( query( qid ), priority, temporaryQuery );
+}
+
+
+void
+Pipeline::prioritize( const QList< query_ptr >& queries, Priority priority )
+{
+    {
+        QMutexLocker lock( &m_mut );
+
+        QSet< QID > moved;
+        foreach ( const query_ptr& q, queries )
+        {
+            if ( !q.isNull() && m_pendingPriority.value( q->id(), -1 ) > priority )
+                moved << q->id();
+        }
+        dequeue( moved );
+
+        QList< query_ptr > queued;
+        foreach ( const query_ptr& q, queries )
+        {
+            if ( !q.isNull() && moved.remove( q->id() ) )
+                queued << q;
+        }
+        enqueue( queued, priority );
+    }
+
+    shuntNext();
+}
+
+
+void
+Pipeline::deprioritize( const QList< query_ptr >& queries )
+{
+    QMutexLocker lock( &m_mut );
+
+    // interactive and next-up queries are still wanted without any view
+    QSet< QID > moved;
+    foreach ( const query_ptr& q, queries )
+    {
+        if ( !q.isNull() && m_pendingPriority.value( q->id(), -1 ) == Visible )
+            moved << q->id();
+    }
+    dequeue( moved );
+
+    QList< query_ptr > queued;
+    foreach ( const query_ptr& q, queries )
+    {
+        if ( !q.isNull() && moved.remove( q->id() ) )
+            queued << q;
+    }
+    enqueue( queued, Background );
 }
 
 
 void
-Pipeline::resolve( QID qid, bool prioritized, bool temporaryQuery )
+Pipeline::cancel( const QList< query_ptr >& queries )
 {
-    resolve( query( qid ), prioritized, temporaryQuery );
+    QList< query_ptr > cancelled;
+    {
+        QMutexLocker lock( &m_mut );
+
+        QSet< QID > qids;
+        foreach ( const query_ptr& q, queries )
+        {
+            if ( q.isNull() || !m_pendingPriority.contains( q->id() ) || qids.contains( q->id() ) )
+                continue;
+
+            if ( !m_queries_temporary.contains( q ) )
+                m_qids.remove( q->id() );
+
+            qids << q->id();
+            cancelled << q;
+        }
+        dequeue( qids );
+    }
+
+    // nobody waiting for these should wait forever
+    foreach ( const query_ptr& q, cancelled )
+        q->onResolvingFinished();
+}
+
+
+void
+Pipeline::enqueue( const QList< query_ptr >& queries, int priority )
+{
+    if ( queries.isEmpty() )
+        return;
+
+    QList< query_ptr >& queue = m_queries_pending[ priority ];
+    if ( queue.isEmpty() )
+        m_waitingSince[ priority ].start();
+
+    // background queries queue up behind each other, anything else goes
+    // ahead of older queries of its class, keeping the order given
+    if ( priority == Background )
+        queue += queries;
+    else
+        queue = queries + queue;
+
+    foreach ( const query_ptr& q, queries )
+        m_pendingPriority.insert( q->id(), priority );
+}
+
+
+void
+Pipeline::dequeue( const QSet< QID >& qids )
+{
+    if ( qids.isEmpty() )
+        return;
+
+    bool touched[ PriorityCount ] = { false };
+    foreach ( const QID& qid, qids )
+    {
+        const int priority = m_pendingPriority.value( qid, -1 );
+        if ( priority < 0 )
+            continue;
+
+        m_pendingPriority.remove( qid );
+        touched[ priority ] = true;
+    }
+
+    // one pass per queue, removing queries one by one would be O(pending) each
+    for ( int priority = 0; priority < PriorityCount; priority++ )
+    {
+        if ( !touched[ priority ] )
+            continue;
+
+        QList< query_ptr > remaining;
+        foreach ( const query_ptr& q, m_queries_pending[ priority ] )
+        {
+            if ( !qids.contains( q->id() ) )
+                remaining << q;
+        }
+        m_queries_pending[ priority ] = remaining;
+    }
+}
+
+
+bool
+Pipeline::canDispatch( int priority ) const
+{
+    const int active = m_qidsPriority.count();
+    switch ( priority )
+    {
+        case Interactive:
+        case NextUp:
+            return active < m_maxConcurrentQueries + RESERVED_CONCURRENT_QUERIES;
+
+        case Visible:
+            return active < m_maxConcurrentQueries;
+
+        case Background:
+            // leaves room for visible queries, which would otherwise wait for slow resolvers to time out
+            return active < m_maxConcurrentQueries && m_activeCount[ Background ] < qMax( 1, m_maxConcurrentQueries / 2 );
+    }
+
+    return false;
+}
+
+
+int
+Pipeline::nextPriority() const
+{
+    // lower classes that got no slot for a while go first, once each
+    for ( int priority = Background; priority > Interactive; priority-- )
+    {
+        if ( !m_queries_pending[ priority ].isEmpty() && canDispatch( priority ) &&
+             m_waitingSince[ priority ].elapsed() > PRIORITY_AGING_TIMEOUT )
+        {
+            return priority;
+        }
+    }
+
+    for ( int priority = Interactive; priority < PriorityCount; priority++ )
+    {
+        if ( !m_queries_pending[ priority ].isEmpty() && canDispatch( priority ) )
+            return priority;
+    }
+
+    return -1;
 }
 
 
 void
-Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
+Pipeline::reportResults( QID qid, const QList< result_ptr >& results, Resolver* resolver )
 {
     if ( !m_running )
         return;
@@ -269,7 +740,7 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
     QList< result_ptr > cleanResults;
     foreach( const result_ptr& r, results )
     {
-        float score = q->howSimilar( r );
+        float score = q->howSimilar( r, q->isFullTextQuery() ? 0.0 : MINSCORE );
         r->setScore( score );
         if ( !q->isFullTextQuery() && score < MINSCORE )
             continue;
@@ -277,6 +748,18 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
         cleanResults << r;
     }
 
+    if ( !resolver )
+        resolver = q->currentResolver();
+
+    {
+        QMutexLocker lock( &m_mut );
+
+        // late answers, after a timeout, don't count. the timeout was recorded already
+        const QHash< Resolver*, QTime > dispatched = m_qidsDispatched.value( q->id() );
+        if ( dispatched.contains( resolver ) )
+            recordReply( resolver, dispatched.value( resolver ).elapsed(), !cleanResults.isEmpty(), false );
+    }
+
     if ( !cleanResults.isEmpty() )
     {
         q->addResults( cleanResults );
@@ -292,7 +775,7 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
         }
     }
 
-    decQIDState( q );
+    decQIDState( q, resolver );
 }
 
 
@@ -366,22 +849,27 @@ Pipeline::shuntNext()
         QMutexLocker lock( &m_mut );
 
         rc = m_resolvers.count();
-        if ( m_queries_pending.isEmpty() )
+        if ( m_pendingPriority.isEmpty() )
         {
             if ( m_qidsState.isEmpty() )
                 emit idle();
             return;
         }
 
-        // Check if we are ready to dispatch more queries
-        if ( m_qidsState.count() >= m_maxConcurrentQueries )
+        // Check if we are ready to dispatch more queries, and of which class
+        int priority = nextPriority();
+        if ( priority < 0 )
             return;
 
         /*
             Since resolvers are async, we now dispatch to the highest weighted ones
             and after timeout, dispatch to next highest etc, aborting when solved
         */
-        q = m_queries_pending.takeFirst();
+        q = m_queries_pending[ priority ].takeFirst();
+        m_pendingPriority.remove( q->id() );
+        m_qidsPriority.insert( q->id(), priority );
+        m_activeCount[ priority ]++;
+        m_waitingSince[ priority ].start();
         q->setCurrentResolver( 0 );
     }
 
@@ -390,16 +878,49 @@ Pipeline::shuntNext()
 
 
 void
-Pipeline::timeoutShunt( const query_ptr& q )
+Pipeline::timeoutShunt( const query_ptr& q, Resolver* r, const QTime& dispatched )
 {
     if ( !m_running )
         return;
 
-    // are we still waiting for a timeout?
-    if ( m_qidsTimeout.contains( q->id() ) )
     {
-        decQIDState( q );
+        QMutexLocker lock( &m_mut );
+
+        // r may have been removed, and deleted, since
+        if ( !m_resolvers.contains( r ) )
+            return;
+
+        // are we still waiting for a timeout? the query may have been resolved again since
+        if ( m_qidsDispatched.value( q->id() ).value( r ) != dispatched )
+            return;
+
+        recordReply( r, dispatched.elapsed(), false, true );
+    }
+
+    decQIDState( q, r );
+}
+
+
+void
+Pipeline::speculativeShunt( const query_ptr& q, Resolver* r, const QTime& dispatched )
+{
+    if ( !m_running || q->playable() )
+        return;
+
+    {
+        QMutexLocker lock( &m_mut );
+
+        if ( !m_resolvers.contains( r ) )
+            return;
+
+        // only while r is the one and only resolver still working on it
+        const QHash< Resolver*, QTime > running = m_qidsDispatched.value( q->id() );
+        if ( running.count() != 1 || running.value( r ) != dispatched )
+            return;
     }
+
+    tLog( LOGVERBOSE ) << "Resolver" << r->name() << "is slow, also trying the next one for" << q->toString();
+    shunt( q );
 }
 
 
@@ -417,20 +938,42 @@ Pipeline::shunt( const query_ptr& q )
     {
         tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << q->toString() << q->solved() << q->id();
 
+        QTime started;
+        started.start();
+
+        unsigned int timeout;
+        unsigned int speculate;
+        {
+            QMutexLocker lock( &m_mut );
+
+            m_qidsDispatched[ q->id() ].insert( r, started );
+
+            timeout = resolverTimeout( r );
+            speculate = speculationDelay( r, timeout );
+        }
+
         q->setCurrentResolver( r );
         r->resolve( q );
         emit resolving( q );
 
-        if ( r->timeout() > 0 )
-        {
-            m_qidsTimeout.insert( q->id(), true );
-            new FuncTimeout( r->timeout(), boost::bind( &Pipeline::timeoutShunt, this, q ), this );
-        }
+        if ( timeout > 0 )
+            new FuncTimeout( timeout, boost::bind( &Pipeline::timeoutShunt, this, q, r, started ), this );
+        if ( speculate > 0 )
+            new FuncTimeout( speculate, boost::bind( &Pipeline::speculativeShunt, this, q, r, started ), this );
     }
     else
     {
-        // we get here if we disable a resolver while a query is resolving
-        setQIDState( q, 0 );
+        bool waiting;
+        {
+            QMutexLocker lock( &m_mut );
+            waiting = !m_qidsDispatched.value( q->id() ).isEmpty();
+        }
+
+        // we get here if we disable a resolver while a query is resolving, or if
+        // there's no resolver left to speculatively dispatch to. in the latter
+        // case the resolvers still working on it finish the query
+        if ( !waiting )
+            setQIDState( q, 0 );
         return;
     }
 
@@ -438,6 +981,69 @@ Pipeline::shunt( const query_ptr& q )
 }
 
 
+unsigned int
+Pipeline::resolverTimeout( Resolver* r ) const
+{
+    // resolvers without a timeout, like the local database, always answer
+    const int timeout = r->timeout();
+    if ( timeout <= 0 )
+        return 0;
+
+    ResolverStats* stats = m_resolverStats.value( r );
+    const int latency = stats ? stats->percentile( TIMEOUT_PERCENTILE ) : -1;
+    if ( latency < 0 )
+        return timeout;
+
+    return qMin( timeout, qMax( TIMEOUT_MIN, latency + qMax( TIMEOUT_MIN_MARGIN, latency / 2 ) ) );
+}
+
+
+unsigned int
+Pipeline::speculationDelay( Resolver* r, unsigned int timeout ) const
+{
+    ResolverStats* stats = m_resolverStats.value( r );
+    const int latency = stats ? stats->percentile( SPECULATE_PERCENTILE ) : -1;
+    if ( latency < 0 )
+        return 0;
+
+    const unsigned int delay = qMax( SPECULATE_MIN, latency );
+    if ( timeout > 0 && delay >= timeout )
+        return 0;
+
+    return delay;
+}
+
+
+void
+Pipeline::recordReply( Resolver* r, int latency, bool hit, bool timedOut )
+{
+    // a timeout or late answer of a resolver that has been removed meanwhile: r may be gone already
+    if ( !m_resolvers.contains( r ) )
+        return;
+
+    ResolverStats* stats = m_resolverStats.value( r );
+    if ( !stats )
+    {
+        stats = new ResolverStats;
+        m_resolverStats.insert( r, stats );
+    }
+
+    stats->add( latency );
+    stats->replies++;
+    if ( hit )
+        stats->hits++;
+    if ( timedOut )
+        stats->timeouts++;
+
+    if ( stats->replies % 100 == 0 )
+    {
+        tLog( LOGVERBOSE ) << "Resolver" << r->name() << "- median:" << stats->percentile( 0.5 ) << "ms, p95:" << stats->percentile( TIMEOUT_PERCENTILE )
+                           << "ms, hit rate:" << (float)stats->hits / stats->replies << "timeouts:" << stats->timeouts << "of" << stats->replies
+                           << "- timeout now:" << resolverTimeout( r ) << "ms";
+    }
+}
+
+
 Tomahawk::Resolver*
 Pipeline::nextResolver( const Tomahawk::query_ptr& query ) const
 {
@@ -467,9 +1073,6 @@ Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
 {
     QMutexLocker lock( &m_mut );
 
-    if ( m_qidsTimeout.contains( query->id() ) )
-        m_qidsTimeout.remove( query->id() );
-
     if ( state > 0 )
     {
         m_qidsState.insert( query->id(), state );
@@ -479,6 +1082,10 @@ Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
     else
     {
         m_qidsState.remove( query->id() );
+        m_qidsDispatched.remove( query->id() );
+        if ( m_qidsPriority.contains( query->id() ) )
+            m_activeCount[ m_qidsPriority.take( query->id() ) ]--;
+
         query->onResolvingFinished();
 
         if ( !m_queries_temporary.contains( query ) )
@@ -506,7 +1113,7 @@ Pipeline::incQIDState( const Tomahawk::query_ptr& query )
 
 
 int
-Pipeline::decQIDState( const Tomahawk::query_ptr& query )
+Pipeline::decQIDState( const Tomahawk::query_ptr& query, Tomahawk::Resolver* r )
 {
     int state = 0;
     {
@@ -515,7 +1122,20 @@ Pipeline::decQIDState( const Tomahawk::query_ptr& query )
         if ( !m_qidsState.contains( query->id() ) )
             return 0;
 
+        // only the first answer or timeout of each dispatch counts
+        QHash< Resolver*, QTime >& dispatched = m_qidsDispatched[ query->id() ];
+        if ( !dispatched.contains( r ) )
+            return m_qidsState.value( query->id() );
+
+        dispatched.remove( r );
         state = m_qidsState.value( query->id() ) - 1;
+
+        // a speculatively dispatched resolver is still working on it, wait for that
+        if ( !dispatched.isEmpty() )
+        {
+            m_qidsState.insert( query->id(), state );
+            return state;
+        }
     }
 
     setQIDState( query, state );
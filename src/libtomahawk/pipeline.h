@@ -25,8 +25,10 @@
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QSet>
 #include <QMutex>
 #include <QTimer>
+#include <QTime>
 
 #include <boost/function.hpp>
 
@@ -43,6 +45,16 @@ class DLLEXPORT Pipeline : public QObject
 Q_OBJECT
 
 public:
+    /// pending queries are dispatched by class first, then in the order they were added
+    enum Priority
+    {
+        Interactive = 0, // explicitly requested by the user, e.g. searches and clicked links
+        NextUp,          // about to be played
+        Visible,         // shown in a view
+        Background,      // imports, refreshes and views that were closed
+        PriorityCount
+    };
+
     static Pipeline* instance();
 
     explicit Pipeline( QObject* parent = 0 );
@@ -50,10 +62,11 @@ public:
 
     bool isRunning() const { return m_running; }
 
-    unsigned int pendingQueryCount() const { return m_queries_pending.count(); }
+    unsigned int pendingQueryCount() const { return m_pendingPriority.count(); }
     unsigned int activeQueryCount() const { return m_qidsState.count(); }
 
-    void reportResults( QID qid, const QList< result_ptr >& results );
+    /// resolver is the one answering, if known. its reply times tune its timeout
+    void reportResults( QID qid, const QList< result_ptr >& results, Tomahawk::Resolver* resolver = 0 );
     void reportAlbums( QID qid, const QList< album_ptr >& albums );
     void reportArtists( QID qid, const QList< artist_ptr >& artists );
 
@@ -66,6 +79,21 @@ public:
 
     void addResolver( Resolver* r );
     void removeResolver( Resolver* r );
+    /// how long the pipeline waits for r to answer right now, adapted to its reply times. 0 means forever
+    unsigned int currentTimeout( Tomahawk::Resolver* r );
+
+    // live queries get re-resolved when the index or the available resolvers change, see Query::get()
+    void registerQuery( const query_ptr& q, bool refreshOnIndexChange );
+    void unregisterQuery( Query* q );
+    /// re-resolve these before all others, e.g. because they are visible
+    void prioritizeRefresh( const QList< query_ptr >& queries );
+
+    /// moves those of the queries that are still waiting up to priority, if they are in a lower class
+    void prioritize( const QList< query_ptr >& queries, Priority priority );
+    /// moves those of the queries that are still waiting to the background, e.g. once their view is gone
+    void deprioritize( const QList< query_ptr >& queries );
+    /// drops those of the queries that are still waiting, queries already dispatched finish normally
+    void cancel( const QList< query_ptr >& queries );
 
     query_ptr query( const QID& qid ) const
     {
@@ -78,9 +106,9 @@ public:
     }
 
 public slots:
-    void resolve( const query_ptr& q, bool prioritized = true, bool temporaryQuery = false );
-    void resolve( const QList<query_ptr>& qlist, bool prioritized = true, bool temporaryQuery = false );
-    void resolve( QID qid, bool prioritized = true, bool temporaryQuery = false );
+    void resolve( const query_ptr& q, Tomahawk::Pipeline::Priority priority = Visible, bool temporaryQuery = false );
+    void resolve( const QList<query_ptr>& qlist, Tomahawk::Pipeline::Priority priority = Visible, bool temporaryQuery = false );
+    void resolve( QID qid, Tomahawk::Pipeline::Priority priority = Visible, bool temporaryQuery = false );
 
     void start();
     void stop();
@@ -94,31 +122,60 @@ signals:
     void resolverRemoved( Resolver* );
 
 private slots:
-    void timeoutShunt( const query_ptr& q );
+    void timeoutShunt( const query_ptr& q, Tomahawk::Resolver* r, const QTime& dispatched );
+    void speculativeShunt( const query_ptr& q, Tomahawk::Resolver* r, const QTime& dispatched );
     void shunt( const query_ptr& q );
     void shuntNext();
 
     void onTemporaryQueryTimer();
 
+    void onIndexChanged();
+    void startRefresh();
+    void refreshNext();
+
 private:
+    enum RefreshTrigger
+    { IndexChanged = 1, ResolversChanged = 2 };
+
+    void scheduleRefresh( int trigger );
+
     Tomahawk::Resolver* nextResolver( const Tomahawk::query_ptr& query ) const;
 
+    struct ResolverStats;
+    // these expect m_mut to be locked
+    unsigned int resolverTimeout( Tomahawk::Resolver* r ) const;
+    unsigned int speculationDelay( Tomahawk::Resolver* r, unsigned int timeout ) const;
+    void recordReply( Tomahawk::Resolver* r, int latency, bool hit, bool timedOut );
+
+    // these expect m_mut to be locked
+    void enqueue( const QList< Tomahawk::query_ptr >& queries, int priority );
+    void dequeue( const QSet< QID >& qids );
+    bool canDispatch( int priority ) const;
+    int nextPriority() const;
+
     void setQIDState( const Tomahawk::query_ptr& query, int state );
     int incQIDState( const Tomahawk::query_ptr& query );
-    int decQIDState( const Tomahawk::query_ptr& query );
+    int decQIDState( const Tomahawk::query_ptr& query, Tomahawk::Resolver* r );
 
     QList< Resolver* > m_resolvers;
     QList< QWeakPointer<Tomahawk::ExternalResolver> > m_scriptResolvers;
     QList< ResolverFactoryFunc > m_resolverFactories;
-    QMap< QID, bool > m_qidsTimeout;
+    // resolvers a query was dispatched to and didn't answer or time out yet, with the time of dispatch
+    QHash< QID, QHash< Resolver*, QTime > > m_qidsDispatched;
+    QHash< Resolver*, ResolverStats* > m_resolverStats;
     QMap< QID, unsigned int > m_qidsState;
     QMap< QID, query_ptr > m_qids;
     QMap< RID, result_ptr > m_rids;
 
     QMutex m_mut; // for m_qids, m_rids
 
-    // store queries here until DB index is loaded, then shunt them all
-    QList< query_ptr > m_queries_pending;
+    // store queries here until DB index is loaded, then shunt them all. one queue per priority class
+    QList< query_ptr > m_queries_pending[ PriorityCount ];
+    QHash< QID, int > m_pendingPriority;
+    // dispatched queries per class and since when a class has been waiting for a slot
+    QHash< QID, int > m_qidsPriority;
+    int m_activeCount[ PriorityCount ];
+    QTime m_waitingSince[ PriorityCount ];
     // store temporary queries here and clean up after timeout threshold
     QList< query_ptr > m_queries_temporary;
 
@@ -126,6 +183,18 @@ private:
     bool m_running;
     QTimer m_temporaryQueryTimer;
 
+    // registry of live queries. triggers are collected for a moment, then the
+    // affected queries are queued and re-resolved at a limited rate
+    QHash< Query*, QWeakPointer< Query > > m_liveQueries;
+    QSet< Query* > m_indexRefreshQueries;
+    QHash< Query*, int > m_refreshQueued; // query -> triggers
+    QList< QWeakPointer< Query > > m_refreshQueue;
+    QList< QWeakPointer< Query > > m_refreshPriorityQueue;
+    int m_refreshTriggers;
+    QTimer m_refreshCoalesceTimer;
+    QTimer m_refreshTimer;
+    QMutex m_refreshMutex;
+
     static Pipeline* s_instance;
 };
 
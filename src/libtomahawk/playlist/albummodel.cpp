@@ -31,6 +31,8 @@
 #include "utils/tomahawkutils.h"
 #include "utils/logger.h"
 
+#define ALBUMS_PAGE_SIZE 200
+
 using namespace Tomahawk;
 
 
@@ -38,6 +40,8 @@ AlbumModel::AlbumModel( QObject* parent )
     : QAbstractItemModel( parent )
     , m_rootItem( new AlbumItem( 0, this ) )
     , m_overwriteOnAdd( false )
+    , m_pageKey( 0 )
+    , m_fetchingPage( false )
 {
 }
 
@@ -249,11 +253,14 @@ AlbumModel::addCollection( const collection_ptr& collection, bool overwrite )
                             << collection->source()->userName();
 
     DatabaseCommand_AllAlbums* cmd = new DatabaseCommand_AllAlbums( collection );
+    cmd->setLimit( ALBUMS_PAGE_SIZE );
     m_overwriteOnAdd = overwrite;
     m_collection = collection;
+    m_pageKey = 0;
+    m_fetchingPage = true;
 
     connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
-                    SLOT( addAlbums( QList<Tomahawk::album_ptr> ) ) );
+                    SLOT( onPageLoaded( QList<Tomahawk::album_ptr> ) ) );
 
     Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 
@@ -292,6 +299,7 @@ AlbumModel::addFilteredCollection( const collection_ptr& collection, unsigned in
     cmd->setSortDescending( true );
     m_overwriteOnAdd = overwrite;
     m_collection = collection;
+    m_pageKey = 0;
 
     connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
                     SLOT( addAlbums( QList<Tomahawk::album_ptr> ) ) );
@@ -307,13 +315,57 @@ AlbumModel::addFilteredCollection( const collection_ptr& collection, unsigned in
 }
 
 
+bool
+AlbumModel::canFetchMore( const QModelIndex& parent ) const
+{
+    return !parent.isValid() && !m_fetchingPage && m_pageKey > 0;
+}
+
+
+void
+AlbumModel::fetchMore( const QModelIndex& parent )
+{
+    if ( !canFetchMore( parent ) )
+        return;
+
+    DatabaseCommand_AllAlbums* cmd = new DatabaseCommand_AllAlbums( m_collection );
+    cmd->setLimit( ALBUMS_PAGE_SIZE );
+    cmd->setAfterAlbumId( m_pageKey );
+    m_fetchingPage = true;
+
+    connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
+                    SLOT( onPageLoaded( QList<Tomahawk::album_ptr> ) ) );
+
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+}
+
+
+void
+AlbumModel::onPageLoaded( const QList<Tomahawk::album_ptr>& albums )
+{
+    m_fetchingPage = false;
+
+    // a short page means we've seen the whole collection
+    if ( albums.count() < ALBUMS_PAGE_SIZE || albums.last().isNull() )
+        m_pageKey = 0;
+    else
+        m_pageKey = albums.last()->id();
+
+    addAlbums( albums );
+}
+
+
 void
 AlbumModel::addAlbums( const QList<Tomahawk::album_ptr>& albums )
 {
     emit loadingFinished();
 
     if ( m_overwriteOnAdd )
+    {
         clear();
+        // only the first page replaces what we had
+        m_overwriteOnAdd = false;
+    }
 
     QList<Tomahawk::album_ptr> trimmedAlbums;
     foreach ( const album_ptr& album, albums )
@@ -67,6 +67,9 @@ public:
     void addCollection( const Tomahawk::collection_ptr& collection, bool overwrite = false );
     void addFilteredCollection( const Tomahawk::collection_ptr& collection, unsigned int amount, DatabaseCommand_AllAlbums::SortOrder order, bool overwrite = false );
 
+    virtual bool canFetchMore( const QModelIndex& parent ) const;
+    virtual void fetchMore( const QModelIndex& parent );
+
     virtual QString title() const { return m_title; }
     virtual QString description() const { return m_description; }
     virtual void setTitle( const QString& title ) { m_title = title; }
@@ -106,6 +109,7 @@ private slots:
 
     void onSourceAdded( const Tomahawk::source_ptr& source );
     void onCollectionChanged();
+    void onPageLoaded( const QList<Tomahawk::album_ptr>& albums );
 
 private:
     QPersistentModelIndex m_currentIndex;
@@ -115,6 +119,10 @@ private:
     QString m_description;
     bool m_overwriteOnAdd;
 
+    // id of the last album loaded, for fetching the next page of a collection
+    unsigned int m_pageKey;
+    bool m_fetchingPage;
+
     Tomahawk::collection_ptr m_collection;
 };
 
@@ -22,11 +22,17 @@
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// tracks loaded per database query. a page fills a few screens, so views only load
+// the rest of a collection when they're scrolled that far
+#define TRACKS_PAGE_SIZE 500
+
 using namespace Tomahawk;
 
 
 CollectionFlatModel::CollectionFlatModel( QObject* parent )
     : TrackModel( parent )
+    , m_fetchingPage( false )
+    , m_fetchAll( false )
 {
 }
 
@@ -60,11 +66,13 @@ CollectionFlatModel::addCollection( const collection_ptr& collection, bool sendN
     if ( sendNotifications )
         emit loadingStarted();
 
-    DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( collection );
-    connect( cmd, SIGNAL( tracks( QList<Tomahawk::query_ptr>, QVariant ) ),
-                    SLOT( onTracksAdded( QList<Tomahawk::query_ptr> ) ), Qt::QueuedConnection );
+    if ( !m_pagedCollections.contains( collection ) )
+        m_pagedCollections << collection;
+    m_pageKeys.insert( collection->source()->id(), QVariantList() );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    // the first page is loaded right away, further ones when views ask for them
+    if ( !m_fetchingPage )
+        fetchPage( collection );
 
     m_loadingCollections << collection.data();
 
@@ -95,6 +103,110 @@ CollectionFlatModel::addFilteredCollection( const collection_ptr& collection, un
 }
 
 
+bool
+CollectionFlatModel::canFetchMore( const QModelIndex& parent ) const
+{
+    return !parent.isValid() && !m_fetchingPage && !m_pagedCollections.isEmpty();
+}
+
+
+void
+CollectionFlatModel::fetchMore( const QModelIndex& parent )
+{
+    if ( !canFetchMore( parent ) )
+        return;
+
+    // collections that haven't shown anything yet go first
+    foreach ( const collection_ptr& collection, m_pagedCollections )
+    {
+        if ( m_pageKeys.value( collection->source()->id() ).isEmpty() )
+        {
+            fetchPage( collection );
+            return;
+        }
+    }
+
+    fetchPage( m_pagedCollections.first() );
+}
+
+
+void
+CollectionFlatModel::setFetchAll( bool fetchAll )
+{
+    m_fetchAll = fetchAll;
+    if ( m_fetchAll )
+        fetchMore( QModelIndex() );
+}
+
+
+bool
+CollectionFlatModel::isLoadedInOrder( int column, Qt::SortOrder order ) const
+{
+    return column == TrackModel::Artist && order == Qt::AscendingOrder;
+}
+
+
+void
+CollectionFlatModel::setCurrentItem( const QModelIndex& index )
+{
+    TrackModel::setCurrentItem( index );
+
+    // keep loading ahead of playback, so it doesn't stop at the end of the loaded pages
+    if ( index.isValid() && index.row() >= rowCount( QModelIndex() ) - TRACKS_PAGE_SIZE / 2 )
+        fetchMore( QModelIndex() );
+}
+
+
+void
+CollectionFlatModel::fetchPage( const collection_ptr& collection )
+{
+    m_fetchingPage = true;
+
+    DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( collection );
+    cmd->setLimit( TRACKS_PAGE_SIZE );
+    cmd->setSortOrder( DatabaseCommand_AllTracks::Artist );
+    cmd->setPageKey( m_pageKeys.value( collection->source()->id() ) );
+    cmd->setData( collection->source()->id() );
+
+    connect( cmd, SIGNAL( page( QList<Tomahawk::query_ptr>, QVariant, QVariantList ) ),
+                    SLOT( onPageLoaded( QList<Tomahawk::query_ptr>, QVariant, QVariantList ) ), Qt::QueuedConnection );
+
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+}
+
+
+void
+CollectionFlatModel::onPageLoaded( const QList<Tomahawk::query_ptr>& tracks, const QVariant& data, const QVariantList& nextKey )
+{
+    m_fetchingPage = false;
+
+    collection_ptr collection;
+    foreach ( const collection_ptr& c, m_pagedCollections )
+    {
+        if ( c->source()->id() == data.toInt() )
+            collection = c;
+    }
+
+    if ( !collection.isNull() )
+    {
+        // the command tells where it stopped, the results of the queries may have changed since
+        if ( nextKey.isEmpty() )
+        {
+            m_pagedCollections.removeAll( collection );
+            m_pageKeys.remove( data.toInt() );
+        }
+        else
+            m_pageKeys.insert( data.toInt(), nextKey );
+    }
+
+    onTracksAdded( tracks );
+
+    // other collections still need their first page, and filtering, shuffling & most sort orders need them all
+    if ( m_fetchAll || m_pageKeys.values().contains( QVariantList() ) )
+        fetchMore( QModelIndex() );
+}
+
+
 void
 CollectionFlatModel::onTracksAdded( const QList<Tomahawk::query_ptr>& tracks )
 {
@@ -116,25 +228,19 @@ CollectionFlatModel::onTracksAdded( const QList<Tomahawk::query_ptr>& tracks )
 void
 CollectionFlatModel::onTracksRemoved( const QList<Tomahawk::query_ptr>& tracks )
 {
-    QList<Tomahawk::query_ptr> t = tracks;
-    for ( int i = rowCount( QModelIndex() ); i >= 0 && t.count(); i-- )
-    {
-        QModelIndex idx = index( i, 0, QModelIndex() );
-        TrackModelItem* item = itemFromIndex( idx );
-        if ( !item )
-            continue;
+    QSet< Tomahawk::Query* > removed;
+    foreach ( const query_ptr& query, tracks )
+        removed << query.data();
 
-        int j = 0;
-        foreach ( const query_ptr& query, t )
-        {
-            if ( item->query().data() == query.data() )
-            {
-                remove( idx );
-                t.removeAt( j );
-                break;
-            }
-
-            j++;
-        }
+    // a single pass over our rows, instead of one per removed track
+    QList< int > rows;
+    for ( int i = 0; i < rowCount( QModelIndex() ); i++ )
+    {
+        TrackModelItem* item = itemFromIndex( index( i, 0, QModelIndex() ) );
+        if ( item && removed.contains( item->query().data() ) )
+            rows << i;
     }
+
+    removeItems( rows );
+    emit trackCountChanged( rowCount( QModelIndex() ) );
 }
@@ -50,6 +50,16 @@ public:
     void addCollection( const Tomahawk::collection_ptr& collection, bool sendNotifications = true );
     void addFilteredCollection( const Tomahawk::collection_ptr& collection, unsigned int amount, DatabaseCommand_AllTracks::SortOrder order );
 
+    // collections are loaded page by page, as views scroll towards the end
+    virtual bool canFetchMore( const QModelIndex& parent ) const;
+    virtual void fetchMore( const QModelIndex& parent );
+    virtual void setFetchAll( bool fetchAll );
+    /// pages come sorted by artist, so sorting that way doesn't need the whole collection
+    virtual bool isLoadedInOrder( int column, Qt::SortOrder order ) const;
+
+public slots:
+    virtual void setCurrentItem( const QModelIndex& index );
+
 signals:
     void repeatModeChanged( Tomahawk::PlaylistInterface::RepeatMode mode );
     void shuffleModeChanged( bool enabled );
@@ -61,12 +71,22 @@ signals:
 private slots:
     void onTracksAdded( const QList<Tomahawk::query_ptr>& tracks );
     void onTracksRemoved( const QList<Tomahawk::query_ptr>& tracks );
+    void onPageLoaded( const QList<Tomahawk::query_ptr>& tracks, const QVariant& data, const QVariantList& nextKey );
 
 private:
+    void fetchPage( const Tomahawk::collection_ptr& collection );
+
     QMap< Tomahawk::collection_ptr, QPair< int, int > > m_collectionRows;
     QList<Tomahawk::query_ptr> m_tracksToAdd;
     // just to keep track of what we are waiting to be loaded
     QList<Tomahawk::Collection*> m_loadingCollections;
+
+    // collections with pages left to load, and by source id the key of the last track loaded
+    // from each. Empty for collections that didn't get their first page yet
+    QList< Tomahawk::collection_ptr > m_pagedCollections;
+    QHash< int, QVariantList > m_pageKeys;
+    bool m_fetchingPage;
+    bool m_fetchAll;
 };
 
 #endif // COLLECTIONFLATMODEL_H
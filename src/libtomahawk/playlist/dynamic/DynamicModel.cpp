@@ -239,7 +239,7 @@ DynamicModel::filterUnresolved( const QList< query_ptr >& entries )
     foreach ( const query_ptr& q, entries )
         connect( q.data(), SIGNAL( resolvingFinished( bool ) ), this, SLOT( filteringTrackResolved( bool ) ) );
 
-    Pipeline::instance()->resolve( entries, true );
+    Pipeline::instance()->resolve( entries );
 }
 
 
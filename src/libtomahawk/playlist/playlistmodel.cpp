@@ -228,30 +228,23 @@ PlaylistModel::insert( const QList< Tomahawk::plentry_ptr >& entries, int row )
         m_savedInsertTracks = entries;
     }
 
-    emit beginInsertRows( QModelIndex(), crows.first, crows.second );
-
     QList< Tomahawk::query_ptr > queries;
-    int i = 0;
-    TrackModelItem* plitem;
+    QList< TrackModelItem* > items;
     foreach( const plentry_ptr& entry, entries )
     {
-        plitem = new TrackModelItem( entry, rootItem(), row + i );
-        plitem->index = createIndex( row + i, 0, plitem );
-        i++;
-
-        if ( entry->query()->id() == currentItemUuid() )
-            setCurrentItem( plitem->index );
+        items << new TrackModelItem( entry );
 
         if ( !entry->query()->resolvingFinished() && !entry->query()->playable() )
         {
             queries << entry->query();
-            m_waitingForResolved.append( entry->query().data() );
+            m_waitingForResolved.insert( entry->query().data() );
             connect( entry->query().data(), SIGNAL( resolvingFinished( bool ) ), SLOT( trackResolved( bool ) ) );
         }
-
-        connect( plitem, SIGNAL( dataChanged() ), SLOT( onDataChanged() ) );
     }
 
+    emit beginInsertRows( QModelIndex(), crows.first, crows.second );
+    insertItems( items, row );
+
     if ( !m_waitingForResolved.isEmpty() )
     {
         Pipeline::instance()->resolve( queries );
@@ -275,7 +268,7 @@ PlaylistModel::trackResolved( bool )
 
     if ( m_waitingForResolved.contains( q ) )
     {
-        m_waitingForResolved.removeAll( q );
+        m_waitingForResolved.remove( q );
         disconnect( q, SIGNAL( resolvingFinished( bool ) ), this, SLOT( trackResolved( bool ) ) );
     }
 
@@ -504,7 +497,7 @@ PlaylistModel::remove( const QModelIndex& index, bool moreToCome )
     if ( item && m_waitingForResolved.contains( item->query().data() ) )
     {
         disconnect( item->query().data(), SIGNAL( resolvingFinished( bool ) ), this, SLOT( trackResolved( bool ) ) );
-        m_waitingForResolved.removeAll( item->query().data() );
+        m_waitingForResolved.remove( item->query().data() );
         if ( m_waitingForResolved.isEmpty() )
             emit loadingFinished();
     }
@@ -21,6 +21,7 @@
 
 #include <QList>
 #include <QHash>
+#include <QSet>
 
 #include "typedefs.h"
 #include "trackmodel.h"
@@ -98,7 +99,7 @@ private:
     bool m_isTemporary;
     bool m_changesOngoing;
     bool m_isLoading;
-    QList< Tomahawk::Query* > m_waitingForResolved;
+    QSet< Tomahawk::Query* > m_waitingForResolved;
     QStringList m_waitForRevision;
 
     int m_savedInsertPos;
@@ -23,24 +23,39 @@
 #include <QDateTime>
 #include <QMimeData>
 #include <QTreeView>
+#include <QtConcurrentRun>
 
 #include "audio/audioengine.h"
 #include "utils/tomahawkutils.h"
+#include "utils/SearchKey.h"
 
 #include "artist.h"
 #include "album.h"
 #include "pipeline.h"
+#include "query.h"
 #include "utils/logger.h"
 
+// display strings are kept for this many rows, a few screens worth
+#define DISPLAY_CACHE_ROWS 2000
+
 using namespace Tomahawk;
 
 
 TrackModel::TrackModel( QObject* parent )
     : QAbstractItemModel( parent )
-    , m_rootItem( new TrackModelItem( 0, this ) )
+    , m_rootItem( new TrackModelItem() )
+    , m_rowsDirtyFrom( 0 )
     , m_readOnly( true )
     , m_style( Detailed )
 {
+    m_displayCache.setMaxCost( DISPLAY_CACHE_ROWS );
+
+    // an interval of 0 still collects everything that changed in one pass of the event loop
+    m_changeTimer.setSingleShot( true );
+    m_changeTimer.setInterval( 0 );
+    connect( &m_changeTimer, SIGNAL( timeout() ), SLOT( emitChanges() ) );
+    connect( &m_keyWatcher, SIGNAL( finished() ), SLOT( onSearchKeysBuilt() ) );
+
     connect( AudioEngine::instance(), SIGNAL( started( Tomahawk::result_ptr ) ), SLOT( onPlaybackStarted( Tomahawk::result_ptr ) ), Qt::DirectConnection );
     connect( AudioEngine::instance(), SIGNAL( stopped() ), SLOT( onPlaybackStopped() ), Qt::DirectConnection );
 }
@@ -48,6 +63,11 @@ TrackModel::TrackModel( QObject* parent )
 
 TrackModel::~TrackModel()
 {
+    // nobody is looking at these anymore
+    if ( Pipeline::instance() )
+        Pipeline::instance()->deprioritize( queries() );
+
+    delete m_rootItem;
 }
 
 
@@ -151,10 +171,33 @@ TrackModel::data( const QModelIndex& index, int role ) const
     if ( role != Qt::DisplayRole ) // && role != Qt::ToolTipRole )
         return QVariant();
 
-    const query_ptr& query = entry->query();
+    // the age is relative to now, caching its text would freeze it
+    if ( index.column() == Age )
+        return displayData( entry->query(), Age );
+
+    QVector< QVariant >* columns = m_displayCache.object( entry );
+    if ( !columns )
+    {
+        columns = new QVector< QVariant >( Score + 1 );
+        for ( int i = 0; i < columns->count(); i++ )
+        {
+            if ( i != Age )
+                (*columns)[i] = displayData( entry->query(), i );
+        }
+
+        m_displayCache.insert( entry, columns );
+    }
+
+    return columns->value( index.column() );
+}
+
+
+QVariant
+TrackModel::displayData( const query_ptr& query, int column ) const
+{
     if ( !query->numResults() )
     {
-        switch( index.column() )
+        switch( column )
         {
             case Artist:
                 return query->artist();
@@ -171,7 +214,7 @@ TrackModel::data( const QModelIndex& index, int role ) const
     }
     else
     {
-        switch( index.column() )
+        switch( column )
         {
             case Artist:
                 return query->results().first()->artist()->name();
@@ -289,6 +332,7 @@ TrackModel::setCurrentItem( const QModelIndex& index )
     if ( oldEntry )
     {
         oldEntry->setIsPlaying( false );
+        itemChanged( oldEntry );
     }
 
     TrackModelItem* entry = itemFromIndex( index );
@@ -297,6 +341,7 @@ TrackModel::setCurrentItem( const QModelIndex& index )
         m_currentIndex = index;
         m_currentUuid = entry->query()->id();
         entry->setIsPlaying( true );
+        itemChanged( entry );
     }
     else
     {
@@ -370,10 +415,23 @@ TrackModel::clear()
     {
         emit loadingFinished();
 
+        if ( Pipeline::instance() )
+            Pipeline::instance()->deprioritize( queries() );
+
         emit beginResetModel();
+
+        foreach ( Query* query, m_itemsByQuery.uniqueKeys() )
+            disconnect( query, 0, this, SLOT( onQueryChanged() ) );
+        m_itemsByQuery.clear();
+        m_changedItems.clear();
+        m_displayCache.clear();
+        m_searchKeys.clear();
+
         delete m_rootItem;
         m_rootItem = 0;
-        m_rootItem = new TrackModelItem( 0, this );
+        m_rootItem = new TrackModelItem();
+        m_rowsDirtyFrom = 0;
+
         emit endResetModel();
     }
 }
@@ -435,22 +493,14 @@ TrackModel::insert( const QList< Tomahawk::query_ptr >& queries, int row )
     crows.first = c;
     crows.second = c + queries.count() - 1;
 
-    emit beginInsertRows( QModelIndex(), crows.first, crows.second );
-
-    int i = 0;
-    TrackModelItem* plitem;
+    QList< TrackModelItem* > items;
     foreach( const query_ptr& query, queries )
     {
-        plitem = new TrackModelItem( query, m_rootItem, row + i );
-        plitem->index = createIndex( row + i, 0, plitem );
-        i++;
-
-        if ( query->id() == currentItemUuid() )
-            setCurrentItem( plitem->index );
-
-        connect( plitem, SIGNAL( dataChanged() ), SLOT( onDataChanged() ) );
+        items << new TrackModelItem( query );
     }
 
+    emit beginInsertRows( QModelIndex(), crows.first, crows.second );
+    insertItems( items, row );
     emit endInsertRows();
     emit trackCountChanged( rowCount( QModelIndex() ) );
 }
@@ -478,19 +528,74 @@ TrackModel::remove( const QModelIndex& index, bool moreToCome )
     if ( index.column() > 0 )
         return;
 
-    TrackModelItem* item = itemFromIndex( index );
-    if ( item )
-    {
-        emit beginRemoveRows( index.parent(), index.row(), index.row() );
-        delete item;
-        emit endRemoveRows();
-    }
+    if ( index.isValid() )
+        removeItems( QList< int >() << index.row() );
 
     if ( !moreToCome )
         emit trackCountChanged( rowCount( QModelIndex() ) );
 }
 
 
+void
+TrackModel::insertItems( const QList< TrackModelItem* >& items, int row )
+{
+    m_rootItem->children.insert( row, items.count(), 0 );
+
+    for ( int i = 0; i < items.count(); i++ )
+    {
+        TrackModelItem* item = items.at( i );
+        item->parent = m_rootItem;
+        item->row = row + i;
+        m_rootItem->children[ row + i ] = item;
+
+        watchItem( item );
+    }
+
+    // the rows that used to sit at row and behind moved down
+    m_rowsDirtyFrom = qMin( m_rowsDirtyFrom, row );
+
+    for ( int i = 0; i < items.count(); i++ )
+    {
+        if ( items.at( i )->query()->id() == currentItemUuid() )
+            setCurrentItem( index( row + i, 0, QModelIndex() ) );
+    }
+}
+
+
+void
+TrackModel::removeItems( QList< int > rows )
+{
+    qSort( rows );
+
+    // go from the bottom up, so the runs we haven't removed yet keep their rows
+    int i = rows.count() - 1;
+    while ( i >= 0 )
+    {
+        const int last = rows.at( i );
+        int first = last;
+        while ( --i >= 0 && rows.at( i ) >= first - 1 )
+            first = rows.at( i );
+
+        if ( first < 0 || last >= m_rootItem->children.count() )
+            continue;
+
+        emit beginRemoveRows( QModelIndex(), first, last );
+
+        for ( int j = first; j <= last; j++ )
+        {
+            TrackModelItem* item = m_rootItem->children.at( j );
+            unwatchItem( item );
+            item->parent = 0;
+            delete item;
+        }
+        m_rootItem->children.remove( first, last - first + 1 );
+        m_rowsDirtyFrom = qMin( m_rowsDirtyFrom, first );
+
+        emit endRemoveRows();
+    }
+}
+
+
 void
 TrackModel::remove( const QList<QModelIndex>& indexes )
 {
@@ -522,6 +627,24 @@ TrackModel::remove( const QList<QPersistentModelIndex>& indexes )
 }
 
 
+int
+TrackModel::rowOf( TrackModelItem* item ) const
+{
+    if ( !item || item->parent != m_rootItem )
+        return -1;
+
+    if ( item->row >= m_rowsDirtyFrom )
+    {
+        for ( int i = m_rowsDirtyFrom; i < m_rootItem->children.count(); i++ )
+            m_rootItem->children.at( i )->row = i;
+
+        m_rowsDirtyFrom = m_rootItem->children.count();
+    }
+
+    return item->row;
+}
+
+
 TrackModelItem*
 TrackModel::itemFromIndex( const QModelIndex& index ) const
 {
@@ -543,6 +666,7 @@ TrackModel::onPlaybackStarted( const Tomahawk::result_ptr& result )
     if ( oldEntry && ( oldEntry->query().isNull() || !oldEntry->query()->numResults() || oldEntry->query()->results().first().data() != result.data() ) )
     {
         oldEntry->setIsPlaying( false );
+        itemChanged( oldEntry );
     }
 }
 
@@ -554,6 +678,7 @@ TrackModel::onPlaybackStopped()
     if ( oldEntry )
     {
         oldEntry->setIsPlaying( false );
+        itemChanged( oldEntry );
     }
 }
 
@@ -599,9 +724,195 @@ TrackModel::columnAlignment( int column ) const
 
 
 void
-TrackModel::onDataChanged()
+TrackModel::watchItem( TrackModelItem* item )
+{
+    Query* query = item->query().data();
+    if ( !query )
+        return;
+
+    // one connection per query, no matter how many rows show it
+    if ( !m_itemsByQuery.contains( query ) )
+    {
+        connect( query, SIGNAL( resultsAdded( QList<Tomahawk::result_ptr> ) ), SLOT( onQueryChanged() ) );
+        connect( query, SIGNAL( resultsRemoved( Tomahawk::result_ptr ) ), SLOT( onQueryChanged() ) );
+        connect( query, SIGNAL( resultsChanged() ), SLOT( onQueryChanged() ) );
+        connect( query, SIGNAL( updated() ), SLOT( onQueryChanged() ) );
+        connect( query, SIGNAL( socialActionsLoaded() ), SLOT( onQueryChanged() ) );
+    }
+
+    m_itemsByQuery.insert( query, item );
+}
+
+
+void
+TrackModel::unwatchItem( TrackModelItem* item )
 {
-    TrackModelItem* p = (TrackModelItem*)sender();
-    if ( p && p->index.isValid() )
-        emit dataChanged( p->index, p->index.sibling( p->index.row(), columnCount() - 1 ) );
+    m_changedItems.remove( item );
+    m_displayCache.remove( item );
+    m_searchKeys.remove( item );
+
+    Query* query = item->query().data();
+    if ( !query )
+        return;
+
+    m_itemsByQuery.remove( query, item );
+    if ( !m_itemsByQuery.contains( query ) )
+        disconnect( query, 0, this, SLOT( onQueryChanged() ) );
+}
+
+
+void
+TrackModel::onQueryChanged()
+{
+    Query* query = qobject_cast< Query* >( sender() );
+    if ( !query )
+        return;
+
+    foreach ( TrackModelItem* item, m_itemsByQuery.values( query ) )
+    {
+        m_searchKeys.remove( item );
+        if ( !m_keyJob.isEmpty() )
+            m_keyJobChanged << item;
+
+        itemChanged( item );
+    }
+}
+
+
+void
+TrackModel::itemChanged( TrackModelItem* item )
+{
+    m_displayCache.remove( item );
+    m_changedItems << item;
+
+    if ( !m_changeTimer.isActive() )
+        m_changeTimer.start();
+}
+
+
+void
+TrackModel::emitChanges()
+{
+    QList< int > rows;
+    foreach ( TrackModelItem* item, m_changedItems )
+    {
+        const int row = rowOf( item );
+        if ( row >= 0 )
+            rows << row;
+    }
+    m_changedItems.clear();
+
+    qSort( rows );
+
+    // one notification per run of neighbouring rows
+    int i = 0;
+    while ( i < rows.count() )
+    {
+        const int first = rows.at( i );
+        int last = first;
+        while ( ++i < rows.count() && rows.at( i ) == last + 1 )
+            last++;
+
+        emit dataChanged( index( first, 0, QModelIndex() ), index( last, columnCount() - 1, QModelIndex() ) );
+    }
+}
+
+
+void
+TrackModel::appendSearchFields( const query_ptr& query, QStringList& fields )
+{
+    if ( query->numResults() )
+    {
+        const result_ptr& r = query->results().first();
+        fields << r->artist()->name() << r->album()->name() << r->track();
+    }
+    else
+        fields << query->artist() << query->album() << query->track();
+}
+
+
+QString
+TrackModel::searchKeyFromFields( const QStringList& fields, int offset )
+{
+    return TomahawkUtils::searchKey( fields.at( offset ) ) +
+           TomahawkUtils::searchKey( fields.at( offset + 1 ) ) +
+           TomahawkUtils::searchKey( fields.at( offset + 2 ) );
+}
+
+
+QStringList
+TrackModel::buildSearchKeys( const QStringList& fields )
+{
+    QStringList keys;
+    keys.reserve( fields.count() / 3 );
+    for ( int i = 0; i + 2 < fields.count(); i += 3 )
+        keys << searchKeyFromFields( fields, i );
+
+    return keys;
+}
+
+
+QString
+TrackModel::searchKey( TrackModelItem* item ) const
+{
+    QHash< TrackModelItem*, QString >::const_iterator it = m_searchKeys.constFind( item );
+    if ( it != m_searchKeys.constEnd() )
+        return it.value();
+
+    QStringList fields;
+    appendSearchFields( item->query(), fields );
+
+    const QString key = searchKeyFromFields( fields, 0 );
+    m_searchKeys.insert( item, key );
+    return key;
+}
+
+
+void
+TrackModel::prepareSearchKeys()
+{
+    if ( !m_keyJob.isEmpty() )
+        return;
+
+    // only the strings are handed to the worker, queries and results stay on this thread
+    QStringList fields;
+    foreach ( TrackModelItem* item, m_rootItem->children )
+    {
+        if ( m_searchKeys.contains( item ) )
+            continue;
+
+        m_keyJob << qMakePair( item, item->query() );
+        appendSearchFields( item->query(), fields );
+    }
+
+    if ( m_keyJob.isEmpty() )
+    {
+        emit searchKeysReady();
+        return;
+    }
+
+    tDebug() << Q_FUNC_INFO << "Building search keys for" << m_keyJob.count() << "tracks";
+    m_keyWatcher.setFuture( QtConcurrent::run( &TrackModel::buildSearchKeys, fields ) );
+}
+
+
+void
+TrackModel::onSearchKeysBuilt()
+{
+    const QStringList keys = m_keyWatcher.result();
+
+    for ( int i = 0; i < m_keyJob.count() && i < keys.count(); i++ )
+    {
+        // rows may have been removed, or their tracks resolved to something else, in the meantime
+        TrackModelItem* item = m_keyJob.at( i ).first;
+        if ( m_keyJobChanged.contains( item ) || !m_itemsByQuery.contains( m_keyJob.at( i ).second.data(), item ) )
+            continue;
+
+        m_searchKeys.insert( item, keys.at( i ) );
+    }
+
+    m_keyJob.clear();
+    m_keyJobChanged.clear();
+
+    emit searchKeysReady();
 }
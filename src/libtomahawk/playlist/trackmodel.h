@@ -22,6 +22,11 @@
 #define TRACKMODEL_H
 
 #include <QAbstractItemModel>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QMultiHash>
+#include <QSet>
+#include <QTimer>
 
 #include "playlistinterface.h"
 #include "trackmodelitem.h"
@@ -94,8 +99,20 @@ public:
     virtual bool shuffled() const { return false; }
 
     virtual void ensureResolved();
+    /// while enabled, lazy models load everything they still hold back, e.g. while being filtered
+    virtual void setFetchAll( bool fetchAll ) { Q_UNUSED( fetchAll ); }
+    /// whether lazy models load their rows in this order anyway, so sorting by it doesn't need them all
+    virtual bool isLoadedInOrder( int column, Qt::SortOrder order ) const { Q_UNUSED( column ); Q_UNUSED( order ); return false; }
 
     TrackModelItem* itemFromIndex( const QModelIndex& index ) const;
+    /// Current row of an item in this model, -1 if it's not in it
+    int rowOf( TrackModelItem* item ) const;
+
+    /// Normalized artist, album and title of an item that filters match against, see TomahawkUtils::searchKey()
+    QString searchKey( TrackModelItem* item ) const;
+    bool hasSearchKeys() const { return m_searchKeys.count() >= rowCount( QModelIndex() ); }
+    /// Builds all missing search keys in the background, emits searchKeysReady() when done
+    void prepareSearchKeys();
     /// Returns a flat list of all tracks in this model
     QList< Tomahawk::query_ptr > queries() const;
 
@@ -110,6 +127,8 @@ signals:
     void loadingStarted();
     void loadingFinished();
 
+    void searchKeysReady();
+
 public slots:
     virtual void setCurrentItem( const QModelIndex& index );
 
@@ -134,16 +153,48 @@ public slots:
 protected:
     TrackModelItem* rootItem() const { return m_rootItem; }
 
+    /// Takes ownership of unparented items and puts them at row. Call between begin/endInsertRows()
+    void insertItems( const QList< TrackModelItem* >& items, int row );
+    /// Removes the given rows in as few contiguous runs as possible
+    void removeItems( QList< int > rows );
+    /// Queues a repaint of the item's row, changes are coalesced and emitted in one go
+    void itemChanged( TrackModelItem* item );
+
 private slots:
-    void onDataChanged();
+    void onQueryChanged();
+    void emitChanges();
+    void onSearchKeysBuilt();
 
     void onPlaybackStarted( const Tomahawk::result_ptr& result );
     void onPlaybackStopped();
 
 private:
     Qt::Alignment columnAlignment( int column ) const;
+    QVariant displayData( const Tomahawk::query_ptr& query, int column ) const;
+
+    static void appendSearchFields( const Tomahawk::query_ptr& query, QStringList& fields );
+    static QString searchKeyFromFields( const QStringList& fields, int offset );
+    static QStringList buildSearchKeys( const QStringList& fields );
+
+    void watchItem( TrackModelItem* item );
+    void unwatchItem( TrackModelItem* item );
 
     TrackModelItem* m_rootItem;
+    // rows from here on have stale TrackModelItem::row values
+    mutable int m_rowsDirtyFrom;
+
+    QMultiHash< Tomahawk::Query*, TrackModelItem* > m_itemsByQuery;
+    QSet< TrackModelItem* > m_changedItems;
+    QTimer m_changeTimer;
+    // display strings of recently painted rows
+    mutable QCache< TrackModelItem*, QVector< QVariant > > m_displayCache;
+
+    mutable QHash< TrackModelItem*, QString > m_searchKeys;
+    // rows whose keys are being built in the background, and those of them that changed meanwhile
+    QList< QPair< TrackModelItem*, Tomahawk::query_ptr > > m_keyJob;
+    QSet< TrackModelItem* > m_keyJobChanged;
+    QFutureWatcher< QStringList > m_keyWatcher;
+
     QPersistentModelIndex m_currentIndex;
     Tomahawk::QID m_currentUuid;
 
@@ -29,46 +29,46 @@ using namespace Tomahawk;
 
 TrackModelItem::~TrackModelItem()
 {
-    // Don't use qDeleteAll here! The children will remove themselves
-    // from the list when they get deleted and the qDeleteAll iterator
-    // will fail badly!
-    if ( parent && index.isValid() )
+    // models unlink rows before deleting them, this only catches strays
+    if ( parent )
     {
-        parent->children.remove( index.row() );
+        int i = parent->children.indexOf( this );
+        if ( i >= 0 )
+            parent->children.remove( i );
     }
 
     for ( int i = children.count() - 1; i >= 0; i-- )
+    {
+        children.at( i )->parent = 0;
         delete children.at( i );
+    }
 }
 
 
-TrackModelItem::TrackModelItem( TrackModelItem* parent, QAbstractItemModel* model )
+TrackModelItem::TrackModelItem()
+    : parent( 0 )
+    , row( -1 )
+    , m_isPlaying( false )
 {
-    this->parent = parent;
-    this->model = model;
-    childCount = 0;
-    toberemoved = false;
-    m_isPlaying = false;
-
-    if ( parent )
-    {
-        parent->children.append( this );
-    }
 }
 
 
-TrackModelItem::TrackModelItem( const Tomahawk::query_ptr& query, TrackModelItem* parent, int row )
-    : QObject( parent )
+TrackModelItem::TrackModelItem( const Tomahawk::query_ptr& query )
+    : parent( 0 )
+    , row( -1 )
+    , m_query( query )
+    , m_isPlaying( false )
 {
-    setupItem( query, parent, row );
 }
 
 
-TrackModelItem::TrackModelItem( const Tomahawk::plentry_ptr& entry, TrackModelItem* parent, int row )
-    : QObject( parent )
+TrackModelItem::TrackModelItem( const Tomahawk::plentry_ptr& entry )
+    : parent( 0 )
+    , row( -1 )
     , m_entry( entry )
+    , m_query( entry->query() )
+    , m_isPlaying( false )
 {
-    setupItem( entry->query(), parent, row );
 }
 
 
@@ -84,34 +84,3 @@ TrackModelItem::query() const
 {
     return m_query;
 }
-
-
-void
-TrackModelItem::setupItem( const Tomahawk::query_ptr& query, TrackModelItem* parent, int row )
-{
-    this->parent = parent;
-    if ( parent )
-    {
-        if ( row < 0 )
-        {
-            parent->children.append( this );
-            row = parent->children.count() - 1;
-        }
-        else
-        {
-            parent->children.insert( row, this );
-        }
-
-        this->model = parent->model;
-    }
-
-    m_isPlaying = false;
-    toberemoved = false;
-    m_query = query;
-
-    connect( query.data(), SIGNAL( resultsAdded( QList<Tomahawk::result_ptr> ) ), SIGNAL( dataChanged() ) );
-    connect( query.data(), SIGNAL( resultsRemoved( Tomahawk::result_ptr ) ), SIGNAL( dataChanged() ) );
-    connect( query.data(), SIGNAL( resultsChanged() ), SIGNAL( dataChanged() ) );
-    connect( query.data(), SIGNAL( updated() ), SIGNAL( dataChanged() ) );
-    connect( query.data(), SIGNAL( socialActionsLoaded() ), SIGNAL( dataChanged() ) );
-}
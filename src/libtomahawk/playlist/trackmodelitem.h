@@ -19,45 +19,38 @@
 #ifndef PLITEM_H
 #define PLITEM_H
 
-#include <QHash>
 #include <QVector>
-#include <QPersistentModelIndex>
-#include <QAbstractItemModel>
 
 #include "typedefs.h"
 
 #include "dllmacro.h"
 
-class DLLEXPORT TrackModelItem : public QObject
+/*
+ * A single row of a TrackModel. Deliberately not a QObject: big collections and
+ * playlists hold one of these per track, so they carry nothing but the track itself.
+ * The owning model watches the queries and takes care of change notifications.
+ */
+class DLLEXPORT TrackModelItem
 {
-Q_OBJECT
-
 public:
-    virtual ~TrackModelItem();
+    ~TrackModelItem();
 
-    explicit TrackModelItem( TrackModelItem* parent = 0, QAbstractItemModel* model = 0 );
-    explicit TrackModelItem( const Tomahawk::query_ptr& query, TrackModelItem* parent = 0, int row = -1 );
-    explicit TrackModelItem( const Tomahawk::plentry_ptr& entry, TrackModelItem* parent = 0, int row = -1 );
+    explicit TrackModelItem();
+    explicit TrackModelItem( const Tomahawk::query_ptr& query );
+    explicit TrackModelItem( const Tomahawk::plentry_ptr& entry );
 
     const Tomahawk::plentry_ptr& entry() const;
     const Tomahawk::query_ptr& query() const;
 
-    bool isPlaying() { return m_isPlaying; }
-    void setIsPlaying( bool b ) { m_isPlaying = b; emit dataChanged(); }
+    bool isPlaying() const { return m_isPlaying; }
+    void setIsPlaying( bool b ) { m_isPlaying = b; }
 
     TrackModelItem* parent;
     QVector<TrackModelItem*> children;
-    int childCount;
-    QPersistentModelIndex index;
-    QAbstractItemModel* model;
-    bool toberemoved;
-
-signals:
-    void dataChanged();
+    // position in the parent. TrackModel renumbers lazily, so ask TrackModel::rowOf() for it
+    int row;
 
 private:
-    void setupItem( const Tomahawk::query_ptr& query, TrackModelItem* parent, int row = -1 );
-
     Tomahawk::plentry_ptr m_entry;
     Tomahawk::query_ptr m_query;
     bool m_isPlaying;
@@ -25,13 +25,19 @@
 #include "artist.h"
 #include "album.h"
 #include "query.h"
+#include "utils/SearchKey.h"
 #include "utils/logger.h"
 
+// models bigger than this get their search keys built in the background
+#define FILTER_ASYNC_ROWS 20000
+
 
 TrackProxyModel::TrackProxyModel( QObject* parent )
     : QSortFilterProxyModel( parent )
     , m_model( 0 )
     , m_showOfflineResults( true )
+    , m_waitingForKeys( false )
+    , m_narrowing( false )
 {
     setFilterCaseSensitivity( Qt::CaseInsensitive );
     setSortCaseSensitivity( Qt::CaseInsensitive );
@@ -58,7 +64,19 @@ TrackProxyModel::setSourceTrackModel( TrackModel* sourceModel )
     if ( m_model && m_model->metaObject()->indexOfSignal( "trackCountChanged(uint)" ) > -1 )
         connect( m_model, SIGNAL( trackCountChanged( unsigned int ) ), playlistInterface().data(), SIGNAL( sourceTrackCountChanged( unsigned int ) ) );
 
+    if ( m_model )
+        connect( m_model, SIGNAL( searchKeysReady() ), SLOT( onSearchKeysReady() ), Qt::UniqueConnection );
+
+    // what matched in the old model says nothing about the new one
+    m_filterTokens.clear();
+    m_filterMatches.clear();
+
     QSortFilterProxyModel::setSourceModel( m_model );
+
+    if ( m_model && !m_filter.isEmpty() )
+        setFilter( m_filter );
+    else
+        updateFetchAll();
 }
 
 
@@ -73,41 +91,104 @@ TrackProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex& sourceParen
     if ( q.isNull() ) // uh oh? filter out invalid queries i guess
         return false;
 
-    Tomahawk::result_ptr r;
-    if ( q->numResults() )
-        r = q->results().first();
+    if ( !m_filterTokens.isEmpty() )
+    {
+        if ( m_narrowing && !m_narrowFrom.contains( pi ) )
+            return false;
+
+        if ( !TomahawkUtils::matchesSearchKey( m_model->searchKey( pi ), m_filterTokens ) )
+        {
+            m_filterMatches.remove( pi );
+            return false;
+        }
 
-    if ( !m_showOfflineResults && !r.isNull() && !r->isOnline() )
+        m_filterMatches << pi;
+    }
+
+    if ( !m_showOfflineResults && q->numResults() && !q->results().first()->isOnline() )
         return false;
 
-    if ( filterRegExp().isEmpty() )
-        return true;
+    return true;
+}
+
+
+void
+TrackProxyModel::sort( int column, Qt::SortOrder order )
+{
+    QSortFilterProxyModel::sort( column, order );
+    updateFetchAll();
+}
+
+
+void
+TrackProxyModel::updateFetchAll()
+{
+    if ( !m_model )
+        return;
+
+    const bool shuffled = !m_playlistInterface.isNull() && m_playlistInterface->shuffled();
+    const bool sorted = sortColumn() >= 0 && !m_model->isLoadedInOrder( sortColumn(), sortOrder() );
+    m_model->setFetchAll( !m_filter.isEmpty() || sorted || shuffled );
+}
+
+
+void
+TrackProxyModel::setFilter( const QString& pattern )
+{
+    m_filter = pattern;
+    updateFetchAll();
 
-    QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
-    foreach( QString s, sl )
+    // normalizing a huge collection takes a while, don't block the ui on it
+    if ( m_model && !pattern.isEmpty() && !m_model->hasSearchKeys() &&
+         m_model->rowCount( QModelIndex() ) > FILTER_ASYNC_ROWS )
     {
-        s = s.toLower();
-        if ( !r.isNull() )
+        if ( !m_waitingForKeys )
         {
-            if ( !r->artist()->name().toLower().contains( s ) &&
-                 !r->album()->name().toLower().contains( s ) &&
-                 !r->track().toLower().contains( s ) )
-            {
-                return false;
-            }
-        }
-        else
-        {
-            if ( !q->artist().toLower().contains( s ) &&
-                 !q->album().toLower().contains( s ) &&
-                 !q->track().toLower().contains( s ) )
-            {
-                return false;
-            }
+            m_waitingForKeys = true;
+            emit filteringStarted();
+            m_model->prepareSearchKeys();
         }
+
+        return;
     }
 
-    return true;
+    applyFilter();
+}
+
+
+void
+TrackProxyModel::onSearchKeysReady()
+{
+    if ( !m_waitingForKeys )
+        return;
+
+    m_waitingForKeys = false;
+    applyFilter();
+
+    Tomahawk::TrackProxyModelPlaylistInterface* pi = qobject_cast< Tomahawk::TrackProxyModelPlaylistInterface* >( m_playlistInterface.data() );
+    if ( pi )
+        pi->sendTrackCount();
+}
+
+
+void
+TrackProxyModel::applyFilter()
+{
+    const QStringList tokens = TomahawkUtils::searchTokens( m_filter );
+
+    m_narrowing = !tokens.isEmpty() && !m_filterTokens.isEmpty() && TomahawkUtils::narrowsSearch( tokens, m_filterTokens );
+    if ( m_narrowing )
+        m_narrowFrom = m_filterMatches;
+
+    m_filterTokens = tokens;
+    m_filterMatches.clear();
+
+    setFilterRegExp( m_filter );
+
+    m_narrowing = false;
+    m_narrowFrom.clear();
+
+    emit filteringFinished();
 }
 
 
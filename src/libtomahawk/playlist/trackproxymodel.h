@@ -21,6 +21,8 @@
 #define TRACKPROXYMODEL_H
 
 #include <QtGui/QSortFilterProxyModel>
+#include <QSet>
+#include <QStringList>
 
 #include "playlistinterface.h"
 #include "playlist/trackmodel.h"
@@ -50,6 +52,12 @@ public:
     virtual void setShowOfflineResults( bool b ) { m_showOfflineResults = b; }
 
     virtual void emitFilterChanged( const QString &pattern ) { emit filterChanged( pattern ); }
+    /// Shows tracks whose artist, album or title have words starting with each word of pattern
+    virtual void setFilter( const QString& pattern );
+
+    virtual void sort( int column, Qt::SortOrder order = Qt::AscendingOrder );
+    /// Filtering, sorting and shuffling need all rows, not just the ones a paging source model loaded so far
+    void updateFetchAll();
 
     virtual TrackModelItem* itemFromIndex( const QModelIndex& index ) const { return sourceModel()->itemFromIndex( index ); }
 
@@ -57,6 +65,8 @@ public:
 
 signals:
     void filterChanged( const QString& filter );
+    void filteringStarted();
+    void filteringFinished();
 
 protected:
     virtual bool filterAcceptsRow( int sourceRow, const QModelIndex& sourceParent ) const;
@@ -65,6 +75,21 @@ protected:
     TrackModel* m_model;
     bool m_showOfflineResults;
     Tomahawk::playlistinterface_ptr m_playlistInterface;
+
+private slots:
+    void onSearchKeysReady();
+
+private:
+    void applyFilter();
+
+    QString m_filter;
+    QStringList m_filterTokens;
+    bool m_waitingForKeys;
+
+    // items matching the current filter. when it gets narrower only these need to be checked again
+    mutable QSet< TrackModelItem* > m_filterMatches;
+    QSet< TrackModelItem* > m_narrowFrom;
+    bool m_narrowing;
 };
 
 #endif // TRACKPROXYMODEL_H
@@ -63,13 +63,26 @@ TrackProxyModelPlaylistInterface::filter() const
 }
 
 
+void
+TrackProxyModelPlaylistInterface::setShuffled( bool enabled )
+{
+    m_shuffled = enabled;
+
+    // a random pick should come from the whole collection, not just what's loaded so far
+    if ( !m_proxyModel.isNull() )
+        m_proxyModel.data()->updateFetchAll();
+
+    emit shuffleModeChanged( enabled );
+}
+
+
 void
 TrackProxyModelPlaylistInterface::setFilter( const QString& pattern )
 {
     if ( m_proxyModel.isNull() )
         return;
 
-    m_proxyModel.data()->setFilterRegExp( pattern );
+    m_proxyModel.data()->setFilter( pattern );
     m_proxyModel.data()->emitFilterChanged( pattern );
 
     emit trackCountChanged( trackCount() );
@@ -103,6 +116,35 @@ TrackProxyModelPlaylistInterface::siblingItem( int itemsAway )
 }
 
 
+Tomahawk::query_ptr
+TrackProxyModelPlaylistInterface::peekNextQuery()
+{
+    // shuffle picks at random when it gets there
+    if ( m_shuffled || m_proxyModel.isNull() )
+        return Tomahawk::query_ptr();
+
+    TrackProxyModel* proxyModel = m_proxyModel.data();
+
+    // unlike siblingItem() this doesn't skip rows that aren't playable (yet), they might just need resolving
+    QModelIndex idx = proxyModel->index( 0, 0 );
+    if ( proxyModel->currentIndex().isValid() )
+    {
+        idx = proxyModel->currentIndex();
+        if ( m_repeatMode != PlaylistInterface::RepeatOne )
+            idx = proxyModel->index( idx.row() + 1, 0 );
+    }
+
+    if ( !idx.isValid() && m_repeatMode == PlaylistInterface::RepeatAll )
+        idx = proxyModel->index( 0, 0 );
+
+    TrackModelItem* item = idx.isValid() ? proxyModel->itemFromIndex( proxyModel->mapToSource( idx ) ) : 0;
+    if ( !item )
+        return Tomahawk::query_ptr();
+
+    return item->query();
+}
+
+
 bool
 TrackProxyModelPlaylistInterface::hasNextItem()
 {
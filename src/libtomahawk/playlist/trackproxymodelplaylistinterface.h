@@ -48,16 +48,19 @@ public:
     virtual Tomahawk::result_ptr siblingItem( int itemsAway );
     virtual Tomahawk::result_ptr siblingItem( int itemsAway, bool readOnly );
     virtual bool hasNextItem();
+    virtual Tomahawk::query_ptr peekNextQuery();
 
     virtual QString filter() const;
     virtual void setFilter( const QString& pattern );
 
+    virtual void sendTrackCount() { emit trackCountChanged( trackCount() ); }
+
     virtual PlaylistInterface::RepeatMode repeatMode() const { return m_repeatMode; }
     virtual bool shuffled() const { return m_shuffled; }
 
 public slots:
     virtual void setRepeatMode( Tomahawk::PlaylistInterface::RepeatMode mode ) { m_repeatMode = mode; emit repeatModeChanged( mode ); }
-    virtual void setShuffled( bool enabled ) { m_shuffled = enabled; emit shuffleModeChanged( enabled ); }
+    virtual void setShuffled( bool enabled );
 
 protected:
     QWeakPointer< TrackProxyModel > m_proxyModel;
@@ -27,6 +27,7 @@
 #include "viewmanager.h"
 #include "trackmodel.h"
 #include "trackproxymodel.h"
+#include "pipeline.h"
 #include "audio/audioengine.h"
 #include "context/ContextWidget.h"
 #include "widgets/overlaywidget.h"
@@ -168,9 +169,6 @@ TrackView::setTrackModel( TrackModel* model )
 void
 TrackView::onViewChanged()
 {
-    if ( m_model->style() != TrackModel::Short && m_model->style() != TrackModel::Large ) // eventual FIXME?
-        return;
-
     if ( m_timer.isActive() )
         m_timer.stop();
 
@@ -199,10 +197,20 @@ TrackView::onScrollTimeout()
     if ( !max )
         return;
 
+    QList< Tomahawk::query_ptr > visible;
     for ( int i = left.row(); i <= max; i++ )
     {
-        m_model->updateDetailedInfo( m_proxyModel->mapToSource( m_proxyModel->index( i, 0 ) ) );
+        const QModelIndex index = m_proxyModel->mapToSource( m_proxyModel->index( i, 0 ) );
+        TrackModelItem* item = m_model->itemFromIndex( index );
+        if ( item && !item->query().isNull() )
+            visible << item->query();
+
+        m_model->updateDetailedInfo( index );
     }
+
+    // these get resolved before hidden rows, and re-resolved first when the index or the resolvers change
+    Pipeline::instance()->prioritize( visible, Pipeline::Visible );
+    Pipeline::instance()->prioritizeRefresh( visible );
 }
 
 
@@ -279,6 +287,7 @@ TrackView::startAutoPlay( const QModelIndex& index )
     if ( item && !item->query().isNull() && !item->query()->resolvingFinished() )
     {
         m_autoPlaying = item->query(); // So we can kill it if user starts autoplaying this playlist again
+        Pipeline::instance()->resolve( item->query(), Pipeline::NextUp );
         NewClosure( item->query().data(), SIGNAL( resolvingFinished( bool ) ), this, SLOT( autoPlayResolveFinished( Tomahawk::query_ptr, int ) ),
                     item->query(), index.row() );
         return;
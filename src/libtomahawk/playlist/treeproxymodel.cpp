@@ -27,6 +27,7 @@
 #include "database/database.h"
 #include "database/databaseimpl.h"
 #include "database/databasecommand_allalbums.h"
+#include "utils/SearchKey.h"
 #include "utils/logger.h"
 
 
@@ -74,6 +75,7 @@ TreeProxyModel::setSourceTreeModel( TreeModel* sourceModel )
 
         connect( m_model, SIGNAL( rowsInserted( QModelIndex, int, int ) ), SLOT( onRowsInserted( QModelIndex, int, int ) ) );
         connect( m_model, SIGNAL( modelReset() ), SLOT( onModelReset() ) );
+        connect( m_model, SIGNAL( rowsRemoved( QModelIndex, int, int ) ), SLOT( onRowsRemoved() ) );
     }
 
     QSortFilterProxyModel::setSourceModel( sourceModel );
@@ -109,6 +111,15 @@ TreeProxyModel::onModelReset()
     m_cache.clear();
     m_artistsFilter.clear();
     m_albumsFilter.clear();
+    m_searchKeys.clear();
+}
+
+
+void
+TreeProxyModel::onRowsRemoved()
+{
+    // the keys are cached per item, which might just have been deleted
+    m_searchKeys.clear();
 }
 
 
@@ -118,6 +129,7 @@ TreeProxyModel::newFilterFromPlaylistInterface( const QString &pattern )
     emit filteringStarted();
 
     m_filter = pattern;
+    m_filterTokens = TomahawkUtils::searchTokens( pattern );
     m_albumsFilter.clear();
 
     if ( m_artistsFilterCmd )
@@ -150,11 +162,13 @@ void
 TreeProxyModel::onFilterArtists( const QList<Tomahawk::artist_ptr>& artists )
 {
     bool finished = true;
-    m_artistsFilter = artists;
+    m_artistsFilter.clear();
     m_artistsFilterCmd = 0;
 
     foreach ( const Tomahawk::artist_ptr& artist, artists )
     {
+        m_artistsFilter << artist->id();
+
         QModelIndex idx = m_model->indexFromArtist( artist );
         if ( m_model->rowCount( idx ) )
         {
@@ -249,29 +263,34 @@ TreeProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex& sourceParent
     if ( m_filter.isEmpty() )
         accepted = true;
     else if ( !item->artist().isNull() )
-        accepted = m_artistsFilter.contains( item->artist() );
+        accepted = m_artistsFilter.contains( item->artist()->id() );
     else if ( !item->album().isNull() )
         accepted = m_albumsFilter.contains( item->album()->id() );
 
-    if ( !accepted )
-    {
-        QStringList sl = m_filter.split( " ", QString::SkipEmptyParts );
-        foreach( const QString& s, sl )
-        {
-            if ( !item->name().contains( s, Qt::CaseInsensitive ) &&
-                 !item->albumName().contains( s, Qt::CaseInsensitive ) &&
-                 !item->artistName().contains( s, Qt::CaseInsensitive ) )
-            {
-                return false;
-            }
-        }
-    }
+    if ( !accepted && !TomahawkUtils::matchesSearchKey( searchKey( item ), m_filterTokens ) )
+        return false;
 
     m_cache.insertMulti( sourceParent, item->result() );
     return true;
 }
 
 
+QString
+TreeProxyModel::searchKey( TreeModelItem* item ) const
+{
+    QHash< TreeModelItem*, QString >::const_iterator it = m_searchKeys.constFind( item );
+    if ( it != m_searchKeys.constEnd() )
+        return it.value();
+
+    const QString key = TomahawkUtils::searchKey( item->name() ) +
+                        TomahawkUtils::searchKey( item->albumName() ) +
+                        TomahawkUtils::searchKey( item->artistName() );
+
+    m_searchKeys.insert( item, key );
+    return key;
+}
+
+
 bool
 TreeProxyModel::lessThan( const QModelIndex& left, const QModelIndex& right ) const
 {
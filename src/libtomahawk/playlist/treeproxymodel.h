@@ -21,6 +21,8 @@
 #define TREEPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QSet>
+#include <QStringList>
 
 #include "playlistinterface.h"
 #include "treemodel.h"
@@ -76,18 +78,22 @@ private slots:
     void onFilterAlbums( const QList<Tomahawk::album_ptr>& albums );
 
     void onModelReset();
+    void onRowsRemoved();
 
 private:
     void filterFinished();
     QString textForItem( TreeModelItem* item ) const;
+    QString searchKey( TreeModelItem* item ) const;
 
     mutable QMap< QPersistentModelIndex, Tomahawk::result_ptr > m_cache;
 
-    QList<Tomahawk::artist_ptr> m_artistsFilter;
-    QList<int> m_albumsFilter;
+    QSet<unsigned int> m_artistsFilter;
+    QSet<unsigned int> m_albumsFilter;
     DatabaseCommand_AllArtists* m_artistsFilterCmd;
 
      QString m_filter;
+    QStringList m_filterTokens;
+    mutable QHash< TreeModelItem*, QString > m_searchKeys;
 
     TreeModel* m_model;
 
@@ -98,6 +98,22 @@ TreeProxyModelPlaylistInterface::siblingItem( int itemsAway )
 }
 
 
+Tomahawk::query_ptr
+TreeProxyModelPlaylistInterface::peekNextQuery()
+{
+    // shuffle picks at random when it gets there
+    if ( m_shuffled )
+        return Tomahawk::query_ptr();
+
+    // tree items are results already, nothing left to resolve
+    Tomahawk::result_ptr result = siblingItem( 1, true );
+    if ( result.isNull() )
+        return Tomahawk::query_ptr();
+
+    return result->toQuery();
+}
+
+
 Tomahawk::result_ptr
 TreeProxyModelPlaylistInterface::siblingItem( int itemsAway, bool readOnly )
 {
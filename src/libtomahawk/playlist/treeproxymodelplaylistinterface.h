@@ -45,6 +45,7 @@ public:
     virtual int trackCount() const;
 
     virtual bool hasNextItem();
+    virtual Tomahawk::query_ptr peekNextQuery();
     virtual Tomahawk::result_ptr currentItem() const;
     virtual Tomahawk::result_ptr siblingItem( int direction );
     virtual Tomahawk::result_ptr siblingItem( int direction, bool readOnly );
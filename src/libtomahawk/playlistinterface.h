@@ -56,6 +56,8 @@ public:
     virtual Tomahawk::result_ptr previousItem();
     virtual bool hasNextItem() { return true; }
     virtual Tomahawk::result_ptr nextItem();
+    /// The query that comes up next, whether it is resolved yet or not. Null if that can't be known in advance, e.g. in shuffle mode
+    virtual Tomahawk::query_ptr peekNextQuery() { return Tomahawk::query_ptr(); }
     virtual Tomahawk::result_ptr siblingItem( int itemsAway ) = 0;
 
     virtual PlaylistInterface::RepeatMode repeatMode() const = 0;
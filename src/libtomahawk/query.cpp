@@ -45,8 +45,9 @@ Query::get( const QString& artist, const QString& track, const QString& album, c
     if ( qid.isEmpty() )
         autoResolve = false;
 
-    query_ptr q = query_ptr( new Query( artist, track, album, qid, autoResolve ), &QObject::deleteLater );
+    query_ptr q = query_ptr( new Query( artist, track, album, qid ), &QObject::deleteLater );
     q->setWeakRef( q.toWeakRef() );
+    Pipeline::instance()->registerQuery( q, autoResolve );
 
     if ( autoResolve )
         Pipeline::instance()->resolve( q );
@@ -60,15 +61,17 @@ Query::get( const QString& query, const QID& qid )
 {
     query_ptr q = query_ptr( new Query( query, qid ), &QObject::deleteLater );
     q->setWeakRef( q.toWeakRef() );
+    if ( !qid.isEmpty() )
+        Pipeline::instance()->registerQuery( q, true );
 
     if ( !qid.isEmpty() )
-        Pipeline::instance()->resolve( q );
+        Pipeline::instance()->resolve( q, Pipeline::Interactive );
 
     return q;
 }
 
 
-Query::Query( const QString& artist, const QString& track, const QString& album, const QID& qid, bool autoResolve )
+Query::Query( const QString& artist, const QString& track, const QString& album, const QID& qid )
     : m_qid( qid )
     , m_artist( artist )
     , m_album( album )
@@ -76,16 +79,6 @@ Query::Query( const QString& artist, const QString& track, const QString& album,
     , m_socialActionsLoaded( false )
 {
     init();
-
-    if ( autoResolve )
-    {
-        connect( Database::instance(), SIGNAL( indexReady() ), SLOT( refreshResults() ), Qt::QueuedConnection );
-    }
-
-    connect( Pipeline::instance(), SIGNAL( resolverAdded( Resolver* ) ),
-             SLOT( onResolverAdded() ), Qt::QueuedConnection );
-    connect( Pipeline::instance(), SIGNAL( resolverRemoved( Resolver* ) ),
-             SLOT( onResolverRemoved() ), Qt::QueuedConnection );
 }
 
 
@@ -94,16 +87,14 @@ Query::Query( const QString& query, const QID& qid )
     , m_fullTextQuery( query )
 {
     init();
-
-    if ( !qid.isEmpty() )
-    {
-        connect( Database::instance(), SIGNAL( indexReady() ), SLOT( refreshResults() ), Qt::QueuedConnection );
-    }
 }
 
 
 Query::~Query()
 {
+    if ( Pipeline::instance() )
+        Pipeline::instance()->unregisterQuery( this );
+
     QMutexLocker lock( &m_mutex );
     m_ownRef.clear();
     m_results.clear();
@@ -141,6 +132,10 @@ Query::updateSortNames()
         m_albumSortname = DatabaseImpl::sortname( m_album );
         m_trackSortname = DatabaseImpl::sortname( m_track );
     }
+
+    m_artistPattern = TomahawkUtils::EditPattern( m_artistSortname );
+    m_albumPattern = TomahawkUtils::EditPattern( m_albumSortname );
+    m_trackPattern = isFullTextQuery() ? m_albumPattern : TomahawkUtils::EditPattern( m_trackSortname );
 }
 
 
@@ -209,7 +204,7 @@ Query::refreshResults()
         m_resolveFinished = false;
         query_ptr q = m_ownRef.toStrongRef();
         if ( q )
-            Pipeline::instance()->resolve( q );
+            Pipeline::instance()->resolve( q, Pipeline::Background );
     }
 }
 
@@ -255,26 +250,6 @@ Query::onResolvingFinished()
 }
 
 
-void
-Query::onResolverAdded()
-{
-    if ( !solved() )
-    {
-        refreshResults();
-    }
-}
-
-
-void
-Query::onResolverRemoved()
-{
-    if ( !solved() )
-    {
-        refreshResults();
-    }
-}
-
-
 QList< result_ptr >
 Query::results() const
 {
@@ -448,53 +423,57 @@ Query::toString() const
 }
 
 
+// similarity of text to pattern between 0.0 and 1.0, or some value below minSimilarity
+static float
+similarity( const TomahawkUtils::EditPattern& pattern, const QString& text, float minSimilarity )
+{
+    const int ml = qMax( pattern.length(), text.length() );
+    if ( ml == 0 )
+        return 1.0;
+
+    int maxDistance = -1;
+    if ( minSimilarity > 0.0 )
+        maxDistance = (int)( ml * ( 1.0 - minSimilarity ) );
+
+    const int dist = pattern.distance( text, maxDistance );
+    return (float)( ml - dist ) / ml;
+}
+
+
 // TODO make clever (ft. featuring live (stuff) etc)
 float
-Query::howSimilar( const Tomahawk::result_ptr& r )
+Query::howSimilar( const Tomahawk::result_ptr& r, float minScore )
 {
     // result values
     const QString rArtistname = r->artist()->sortname();
     const QString rAlbumname  = DatabaseImpl::sortname( r->album()->name() );
     const QString rTrackname  = DatabaseImpl::sortname( r->track() );
 
-    // normal edit distance
-    int artdist = levenshtein( m_artistSortname, rArtistname );
-    int albdist = levenshtein( m_albumSortname, rAlbumname );
-    int trkdist = levenshtein( m_trackSortname, rTrackname );
-
-    // max length of name
-    int mlart = qMax( m_artistSortname.length(), rArtistname.length() );
-    int mlalb = qMax( m_albumSortname.length(), rAlbumname.length() );
-    int mltrk = qMax( m_trackSortname.length(), rTrackname.length() );
-
-    // distance scores
-    float dcart = (float)( mlart - artdist ) / mlart;
-    float dcalb = (float)( mlalb - albdist ) / mlalb;
-    float dctrk = (float)( mltrk - trkdist ) / mltrk;
-
     if ( isFullTextQuery() )
     {
-        const QString artistTrackname = DatabaseImpl::sortname( fullTextQuery() );
-        const QString rArtistTrackname  = DatabaseImpl::sortname( r->artist()->name() + " " + r->track() );
-
-        int atrdist = levenshtein( artistTrackname, rArtistTrackname );
-        int mlatr = qMax( artistTrackname.length(), rArtistTrackname.length() );
-        float dcatr = (float)( mlatr - atrdist ) / mlatr;
+        // only the best match counts, the others just need to be known to be worse
+        const QString rArtistTrackname = DatabaseImpl::sortname( r->artist()->name() + " " + r->track() );
 
-        float res = qMax( dcart, dcalb );
-        res = qMax( res, dcatr );
-        return qMax( res, dctrk );
+        float res = qMax( minScore, similarity( m_artistPattern, rArtistname, minScore ) );
+        res = qMax( res, similarity( m_trackPattern, rTrackname, res ) );
+        res = qMax( res, similarity( m_albumPattern, rArtistTrackname, res ) );
+        res = qMax( res, similarity( m_albumPattern, rAlbumname, res ) );
+        return res;
     }
-    else
-    {
-        // don't penalize for missing album name
-        if ( m_albumSortname.isEmpty() )
-            dcalb = 1.0;
 
-        // weighted, so album match is worth less than track title
-        float combined = ( dcart * 4 + dcalb + dctrk * 5 ) / 10;
-        return combined;
-    }
+    // weighted, so album match is worth less than track title. Each field only has to
+    // score well enough for the total to still reach minScore with perfect remaining fields
+    const float target = minScore * 10;
+
+    float dctrk = similarity( m_trackPattern, rTrackname, ( target - 5 ) / 5 );
+    float dcart = similarity( m_artistPattern, rArtistname, ( target - dctrk * 5 - 1 ) / 4 );
+
+    // don't penalize for missing album name
+    float dcalb = 1.0;
+    if ( !m_albumSortname.isEmpty() )
+        dcalb = similarity( m_albumPattern, rAlbumname, target - dctrk * 5 - dcart * 4 );
+
+    return ( dcart * 4 + dcalb + dctrk * 5 ) / 10;
 }
 
 
@@ -693,83 +672,3 @@ Query::cover( const QSize& size, bool forceLoad ) const
     return QPixmap();
 }
 #endif
-
-
-int
-Query::levenshtein( const QString& source, const QString& target )
-{
-    // Step 1
-    const int n = source.length();
-    const int m = target.length();
-
-    if ( n == 0 )
-        return m;
-    if ( m == 0 )
-        return n;
-
-    // Good form to declare a TYPEDEF
-    typedef QVector< QVector<int> > Tmatrix;
-    Tmatrix matrix;
-    matrix.resize( n + 1 );
-
-    // Size the vectors in the 2.nd dimension. Unfortunately C++ doesn't
-    // allow for allocation on declaration of 2.nd dimension of vec of vec
-    for ( int i = 0; i <= n; i++ )
-    {
-        QVector<int> tmp;
-        tmp.resize( m + 1 );
-        matrix.insert( i, tmp );
-    }
-
-    // Step 2
-    for ( int i = 0; i <= n; i++ )
-        matrix[i][0] = i;
-    for ( int j = 0; j <= m; j++ )
-        matrix[0][j] = j;
-
-    // Step 3
-    for ( int i = 1; i <= n; i++ )
-    {
-        const QChar s_i = source[i - 1];
-
-        // Step 4
-        for ( int j = 1; j <= m; j++ )
-        {
-            const QChar t_j = target[j - 1];
-
-            // Step 5
-            int cost;
-            if ( s_i == t_j )
-                cost = 0;
-            else
-                cost = 1;
-
-            // Step 6
-            const int above = matrix[i - 1][j];
-            const int left = matrix[i][j - 1];
-            const int diag = matrix[i - 1][j - 1];
-
-            int cell = ( ( ( left + 1 ) > ( diag + cost ) ) ? diag + cost : left + 1 );
-            if ( above + 1 < cell )
-                cell = above + 1;
-
-            // Step 6A: Cover transposition, in addition to deletion,
-            // insertion and substitution. This step is taken from:
-            // Berghel, Hal ; Roach, David : "An Extension of Ukkonen's
-            // Enhanced Dynamic Programming ASM Algorithm"
-            // (http://www.acm.org/~hlb/publications/asm/asm.html)
-            if ( i > 2 && j > 2 )
-            {
-                int trans = matrix[i - 2][j - 2] + 1;
-
-                if ( source[ i - 2 ] != t_j ) trans++;
-                if ( s_i != target[ j - 2 ] ) trans++;
-                if ( cell > trans ) cell = trans;
-            }
-            matrix[i][j] = cell;
-        }
-    }
-
-    // Step 7
-    return matrix[n][m];
-}
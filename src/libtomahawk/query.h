@@ -27,6 +27,7 @@
 
 #include "typedefs.h"
 #include "result.h"
+#include "utils/EditDistance.h"
 
 #include "dllmacro.h"
 
@@ -76,7 +77,8 @@ public:
     QString fullTextQuery() const { return m_fullTextQuery; }
     bool isFullTextQuery() const { return !m_fullTextQuery.isEmpty(); }
     bool resolvingFinished() const { return m_resolveFinished; }
-    float howSimilar( const Tomahawk::result_ptr& r );
+    /// scores that turn out lower than minScore are only guaranteed to stay below it
+    float howSimilar( const Tomahawk::result_ptr& r, float minScore = 0.0 );
 
     QPair< Tomahawk::source_ptr, unsigned int > playedBy() const;
     Tomahawk::Resolver* currentResolver() const;
@@ -155,10 +157,6 @@ public slots:
 
     void onResolvingFinished();
 
-    // resolve if not solved()
-    void onResolverAdded();
-    void onResolverRemoved();
-
 private slots:
     void onResultStatusChanged();
     void refreshResults();
@@ -166,7 +164,7 @@ private slots:
 
 private:
     Query();
-    explicit Query( const QString& artist, const QString& track, const QString& album, const QID& qid, bool autoResolve );
+    explicit Query( const QString& artist, const QString& track, const QString& album, const QID& qid );
     explicit Query( const QString& query, const QID& qid );
 
     void init();
@@ -176,7 +174,6 @@ private:
     void checkResults();
 
     void updateSortNames();
-    static int levenshtein( const QString& source, const QString& target );
 
     void parseSocialActions();
 
@@ -193,6 +190,11 @@ private:
     QString m_albumSortname;
     QString m_trackSortname;
 
+    // sortnames prepared for scoring results against
+    TomahawkUtils::EditPattern m_artistPattern;
+    TomahawkUtils::EditPattern m_albumPattern;
+    TomahawkUtils::EditPattern m_trackPattern;
+
     QString m_artist;
     QString m_composer;
     QString m_album;
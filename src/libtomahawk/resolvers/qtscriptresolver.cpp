@@ -45,6 +45,9 @@
 // this one keeps old code invokable
 #define RESOLVER_LEGACY_CODE2 "var resolver = Tomahawk.resolver.instance ? Tomahawk.resolver.instance : window;"
 
+// max time in ms we spend calling into resolvers before letting the event loop run again
+#define RESOLVE_TIME_SLICE 10
+
 
 QtScriptResolverHelper::QtScriptResolverHelper( const QString& scriptPath, QtScriptResolver* parent )
     : QObject( parent )
@@ -117,11 +120,7 @@ void
 QtScriptResolverHelper::addTrackResults( const QVariantMap& results )
 {
     qDebug() << "Resolver reporting results:" << results;
-    QList< Tomahawk::result_ptr > tracks = m_resolver->parseResultVariantList( results.value("results").toList() );
-
-    QString qid = results.value("qid").toString();
-
-    Tomahawk::Pipeline::instance()->reportResults( qid, tracks );
+    m_resolver->reportResults( results.value( "qid" ).toString(), results.value( "results" ).toList() );
 }
 
 
@@ -210,6 +209,10 @@ QtScriptResolver::QtScriptResolver( const QString& scriptPath )
 {
     tLog() << Q_FUNC_INFO << "Loading JS resolver:" << scriptPath;
 
+    m_resolveTimer.setSingleShot( true );
+    m_resolveTimer.setInterval( 0 );
+    connect( &m_resolveTimer, SIGNAL( timeout() ), SLOT( resolvePending() ) );
+
     m_engine = new ScriptEngine( this );
     m_name = QFileInfo( filePath() ).baseName();
 
@@ -339,6 +342,33 @@ QtScriptResolver::resolve( const Tomahawk::query_ptr& query )
         return;
     }
 
+    m_pending << query;
+    if ( !m_resolveTimer.isActive() )
+        m_resolveTimer.start();
+}
+
+
+void
+QtScriptResolver::resolvePending()
+{
+    QTime t;
+    t.start();
+
+    while ( !m_pending.isEmpty() && t.elapsed() < RESOLVE_TIME_SLICE )
+    {
+        const Tomahawk::query_ptr query = m_pending.takeFirst();
+        if ( !query->resolvingFinished() )
+            resolveQuery( query );
+    }
+
+    if ( !m_pending.isEmpty() )
+        m_resolveTimer.start();
+}
+
+
+void
+QtScriptResolver::resolveQuery( const Tomahawk::query_ptr& query )
+{
     QString eval;
     if ( !query->isFullTextQuery() )
     {
@@ -370,12 +400,14 @@ QtScriptResolver::resolve( const Tomahawk::query_ptr& query )
 
     qDebug() << "JavaScript Result:" << m;
 
-    const QString qid = query->id();
-    const QVariantList reslist = m.value( "results" ).toList();
+    reportResults( query->id(), m.value( "results" ).toList() );
+}
 
-    QList< Tomahawk::result_ptr > results = parseResultVariantList( reslist );
 
-    Tomahawk::Pipeline::instance()->reportResults( qid, results );
+void
+QtScriptResolver::reportResults( const Tomahawk::QID& qid, const QVariantList& reslist )
+{
+    reportResultsWithIds( qid, parseResultVariantList( reslist ) );
 }
 
 
@@ -388,10 +420,11 @@ QtScriptResolver::parseResultVariantList( const QVariantList& reslist )
     {
         QVariantMap m = rv.toMap();
 
+        // ids are looked up later, see reportResults()
         Tomahawk::result_ptr rp = Tomahawk::Result::get( m.value( "url" ).toString() );
-        Tomahawk::artist_ptr ap = Tomahawk::Artist::get( m.value( "artist" ).toString(), false );
+        Tomahawk::artist_ptr ap = Tomahawk::Artist::get( 0, m.value( "artist" ).toString() );
         rp->setArtist( ap );
-        rp->setAlbum( Tomahawk::Album::get( ap, m.value( "album" ).toString(), false ) );
+        rp->setAlbum( Tomahawk::Album::get( 0, m.value( "album" ).toString(), ap ) );
         rp->setTrack( m.value( "track" ).toString() );
         rp->setAlbumPos( m.value( "albumpos" ).toUInt() );
         rp->setBitrate( m.value( "bitrate" ).toUInt() );
@@ -433,6 +466,7 @@ void
 QtScriptResolver::stop()
 {
     m_stopped = true;
+    m_pending.clear();
     Tomahawk::Pipeline::instance()->removeResolver( this );
     emit stopped();
 }
@@ -28,6 +28,7 @@
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtWebKit/QWebPage>
 #include <QtWebKit/QWebFrame>
 
@@ -145,8 +146,13 @@ public slots:
 signals:
     void stopped();
 
+private slots:
+    void resolvePending();
+
 private:
     void init();
+    void resolveQuery( const Tomahawk::query_ptr& query );
+    void reportResults( const Tomahawk::QID& qid, const QVariantList& reslist );
 
     void loadUi();
     QWidget* findWidget( QWidget* widget, const QString& objectName );
@@ -173,6 +179,10 @@ private:
     QtScriptResolverHelper* m_resolverHelper;
     QWeakPointer< QWidget > m_configWidget;
     QList< QVariant > m_dataWidgets;
+
+    // QtWebKit only runs in the GUI thread, so we feed it queries in small slices
+    QList< Tomahawk::query_ptr > m_pending;
+    QTimer m_resolveTimer;
 };
 
 #endif // QTSCRIPTRESOLVER_H
@@ -35,10 +35,13 @@
 #include <shlwapi.h>
 #endif
 
+#define MAX_BATCH_SIZE 500
+
 ScriptResolver::ScriptResolver( const QString& exe )
     : Tomahawk::ExternalResolverGui( exe )
     , m_num_restarts( 0 )
     , m_msgsize( 0 )
+    , m_maxInFlight( 0 )
     , m_ready( false )
     , m_stopped( true )
     , m_configSent( false )
@@ -50,6 +53,13 @@ ScriptResolver::ScriptResolver( const QString& exe )
     connect( &m_proc, SIGNAL( readyReadStandardOutput() ), SLOT( readStdout() ) );
     connect( &m_proc, SIGNAL( finished( int, QProcess::ExitStatus ) ), SLOT( cmdExited( int, QProcess::ExitStatus ) ) );
 
+    m_batchTimer.setSingleShot( true );
+    m_batchTimer.setInterval( 0 );
+    connect( &m_batchTimer, SIGNAL( timeout() ), SLOT( sendPending() ) );
+
+    m_inFlightTimer.setSingleShot( true );
+    connect( &m_inFlightTimer, SIGNAL( timeout() ), SLOT( sendPending() ) );
+
     startProcess();
 
     if ( !TomahawkUtils::nam() )
@@ -174,29 +184,32 @@ ScriptResolver::error() const
 void
 ScriptResolver::readStdout()
 {
-    if ( m_msgsize == 0 )
+    // a batch is answered with many msgs in a row, handle all that arrived
+    forever
     {
-        if ( m_proc.bytesAvailable() < 4 )
-            return;
+        if ( m_msgsize == 0 )
+        {
+            if ( m_proc.bytesAvailable() < 4 )
+                return;
 
-        quint32 len_nbo;
-        m_proc.read( (char*) &len_nbo, 4 );
-        m_msgsize = qFromBigEndian( len_nbo );
-    }
+            quint32 len_nbo;
+            m_proc.read( (char*) &len_nbo, 4 );
+            m_msgsize = qFromBigEndian( len_nbo );
+        }
 
-    if ( m_msgsize > 0 )
-    {
-        m_msg.append( m_proc.read( m_msgsize - m_msg.length() ) );
-    }
+        if ( m_msgsize > 0 )
+        {
+            m_msg.append( m_proc.read( m_msgsize - m_msg.length() ) );
+        }
 
-    if ( m_msgsize == (quint32) m_msg.length() )
-    {
-        handleMsg( m_msg );
+        if ( m_msgsize != (quint32) m_msg.length() )
+            return;
+
+        const QByteArray msg = m_msg;
         m_msgsize = 0;
         m_msg.clear();
 
-        if ( m_proc.bytesAvailable() )
-            QTimer::singleShot( 0, this, SLOT( readStdout() ) );
+        handleMsg( msg );
     }
 }
 
@@ -248,6 +261,9 @@ ScriptResolver::handleMsg( const QByteArray& msg )
     else if ( msgtype == "results" )
     {
         const QString qid = m.value( "qid" ).toString();
+        if ( m_inFlight.remove( qid ) && !m_pending.isEmpty() && !m_batchTimer.isActive() )
+            m_batchTimer.start();
+
         QList< Tomahawk::result_ptr > results;
         const QVariantList reslist = m.value( "results" ).toList();
 
@@ -256,10 +272,11 @@ ScriptResolver::handleMsg( const QByteArray& msg )
             QVariantMap m = rv.toMap();
             qDebug() << "Found result:" << m;
 
+            // ids are looked up in the database thread below
             Tomahawk::result_ptr rp = Tomahawk::Result::get( m.value( "url" ).toString() );
-            Tomahawk::artist_ptr ap = Tomahawk::Artist::get( m.value( "artist" ).toString(), false );
+            Tomahawk::artist_ptr ap = Tomahawk::Artist::get( 0, m.value( "artist" ).toString() );
             rp->setArtist( ap );
-            rp->setAlbum( Tomahawk::Album::get( ap, m.value( "album" ).toString(), false ) );
+            rp->setAlbum( Tomahawk::Album::get( 0, m.value( "album" ).toString(), ap ) );
             rp->setAlbumPos( m.value( "albumpos" ).toUInt() );
             rp->setTrack( m.value( "track" ).toString() );
             rp->setDuration( m.value( "duration" ).toUInt() );
@@ -280,7 +297,7 @@ ScriptResolver::handleMsg( const QByteArray& msg )
             results << rp;
         }
 
-        Tomahawk::Pipeline::instance()->reportResults( qid, results );
+        reportResultsWithIds( qid, results );
     }
     else
     {
@@ -294,6 +311,8 @@ void
 ScriptResolver::cmdExited( int code, QProcess::ExitStatus status )
 {
     m_ready = false;
+    m_pending.clear();
+    m_inFlight.clear();
     tLog() << Q_FUNC_INFO << "SCRIPT EXITED, code" << code << "status" << status << filePath();
     Tomahawk::Pipeline::instance()->removeResolver( this );
 
@@ -324,9 +343,92 @@ ScriptResolver::cmdExited( int code, QProcess::ExitStatus status )
 void
 ScriptResolver::resolve( const Tomahawk::query_ptr& query )
 {
-    QVariantMap m;
-    m.insert( "_msgtype", "rq" );
+    m_pending << query;
+    if ( !m_batchTimer.isActive() )
+        m_batchTimer.start();
+}
+
+
+void
+ScriptResolver::sendPending()
+{
+    m_batchTimer.stop();
+    expireInFlight();
+
+    const bool batch = m_capabilities.contains( "batch" );
+    while ( !m_pending.isEmpty() )
+    {
+        if ( m_maxInFlight > 0 && (unsigned int)m_inFlight.count() >= m_maxInFlight )
+        {
+            // full, answers restart us. if none come, try again once the oldest expired
+            const unsigned int timeout = Tomahawk::Pipeline::instance()->currentTimeout( this );
+            if ( timeout > 0 && !m_inFlightTimer.isActive() )
+                m_inFlightTimer.start( timeout );
+            return;
+        }
+
+        const Tomahawk::query_ptr query = m_pending.takeFirst();
+        if ( query->resolvingFinished() || m_inFlight.contains( query->id() ) )
+            continue;
+
+        if ( m_maxInFlight > 0 )
+            m_inFlight.insert( query->id(), QTime::currentTime() );
+
+        if ( !batch )
+        {
+            QVariantMap m = queryMsg( query );
+            m.insert( "_msgtype", "rq" );
+            sendMessage( m );
+            continue;
+        }
+
+        QVariantList queries;
+        queries << queryMsg( query );
+        while ( !m_pending.isEmpty() && queries.count() < MAX_BATCH_SIZE &&
+                ( m_maxInFlight == 0 || (unsigned int)m_inFlight.count() < m_maxInFlight ) )
+        {
+            const Tomahawk::query_ptr q = m_pending.takeFirst();
+            if ( q->resolvingFinished() || m_inFlight.contains( q->id() ) )
+                continue;
+
+            if ( m_maxInFlight > 0 )
+                m_inFlight.insert( q->id(), QTime::currentTime() );
+            queries << queryMsg( q );
+        }
+
+        QVariantMap m;
+        m.insert( "_msgtype", "rqbatch" );
+        m.insert( "queries", queries );
+        sendMessage( m );
+    }
+}
 
+
+void
+ScriptResolver::expireInFlight()
+{
+    // the pipeline adapts our timeout to how fast we answer. Once it gave up on a query,
+    // don't let that one block newer queries any longer
+    const unsigned int timeout = Tomahawk::Pipeline::instance()->currentTimeout( this );
+    if ( timeout == 0 )
+        return;
+
+    QHash< Tomahawk::QID, QTime >::iterator it = m_inFlight.begin();
+    while ( it != m_inFlight.end() )
+    {
+        const int elapsed = it.value().elapsed();
+        if ( elapsed < 0 || elapsed > (int)timeout )
+            it = m_inFlight.erase( it );
+        else
+            ++it;
+    }
+}
+
+
+QVariantMap
+ScriptResolver::queryMsg( const Tomahawk::query_ptr& query ) const
+{
+    QVariantMap m;
     if ( query->isFullTextQuery() )
     {
         m.insert( "fulltext", query->fullTextQuery() );
@@ -341,8 +443,7 @@ ScriptResolver::resolve( const Tomahawk::query_ptr& query )
         m.insert( "qid", query->id() );
     }
 
-    const QByteArray msg = m_serializer.serialize( QVariant( m ) );
-    sendMsg( msg );
+    return m;
 }
 
 
@@ -354,7 +455,10 @@ ScriptResolver::doSetup( const QVariantMap& m )
     m_name    = m.value( "name" ).toString();
     m_weight  = m.value( "weight", 0 ).toUInt();
     m_timeout = m.value( "timeout", 5 ).toUInt() * 1000;
-    qDebug() << "SCRIPT" << filePath() << "READY," << "name" << m_name << "weight" << m_weight << "timeout" << m_timeout;
+    m_maxInFlight = m.value( "maxinflight", 0 ).toUInt();
+    m_capabilities = m.value( "capabilities" ).toStringList();
+    qDebug() << "SCRIPT" << filePath() << "READY," << "name" << m_name << "weight" << m_weight << "timeout" << m_timeout
+             << "max in flight" << m_maxInFlight << "capabilities" << m_capabilities;
 
     m_ready = true;
     m_configSent = false;
@@ -21,6 +21,8 @@
 #define SCRIPTRESOLVER_H
 
 #include <QProcess>
+#include <QTimer>
+#include <QTime>
 
 #include <qjson/parser.h>
 #include <qjson/serializer.h>
@@ -32,6 +34,14 @@
 
 class QWidget;
 
+/*
+    Talks to an external resolver process with length-prefixed JSON messages over stdin/stdout.
+
+    A resolver may list "batch" in the "capabilities" of its settings (ready) message. It then
+    gets queries as one "rqbatch" message carrying a "queries" list, instead of one "rq" each,
+    and answers with one "results" message per qid as soon as it has them.
+    It can also set "maxinflight", the number of unanswered queries it wants to have at most.
+*/
 class DLLEXPORT ScriptResolver : public Tomahawk::ExternalResolverGui
 {
 Q_OBJECT
@@ -70,8 +80,12 @@ private slots:
     void readStdout();
     void cmdExited( int code, QProcess::ExitStatus status );
 
+    void sendPending();
+
 private:
     void sendConfig();
+    QVariantMap queryMsg( const Tomahawk::query_ptr& query ) const;
+    void expireInFlight();
 
     void handleMsg( const QByteArray& msg );
     void sendMsg( const QByteArray& msg );
@@ -88,6 +102,15 @@ private:
     quint32 m_msgsize;
     QByteArray m_msg;
 
+    QStringList m_capabilities;
+    unsigned int m_maxInFlight;
+
+    // queries arriving within the same event loop pass are sent together
+    QList< Tomahawk::query_ptr > m_pending;
+    QHash< Tomahawk::QID, QTime > m_inFlight;
+    QTimer m_batchTimer;
+    QTimer m_inFlightTimer; // retries while maxinflight is reached and no answers come
+
     bool m_ready, m_stopped, m_configSent, m_deleting;
     ExternalResolver::ErrorState m_error;
 
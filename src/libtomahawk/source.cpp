@@ -27,7 +27,6 @@
 #include "database/databasecommand_addsource.h"
 #include "database/databasecommand_collectionstats.h"
 #include "database/databasecommand_sourceoffline.h"
-#include "database/databasecommand_updatesearchindex.h"
 #include "database/database.h"
 
 #include <QCoreApplication>
@@ -36,6 +35,9 @@
 #include "utils/tomahawkutilsgui.h"
 #include "database/databasecommand_socialaction.h"
 
+// max number of synced commands applied in one transaction
+#define BULK_APPLY_SIZE 1000
+
 using namespace Tomahawk;
 
 
@@ -390,12 +392,14 @@ Source::executeCommands()
 
     if ( !m_cmds.isEmpty() )
     {
+        // hand over a whole run of groupable commands at once, the worker applies
+        // them in a single transaction instead of one round-trip per command
         QList< QSharedPointer<DatabaseCommand> > cmdGroup;
         QSharedPointer<DatabaseCommand> cmd = m_cmds.takeFirst();
         while ( cmd->groupable() )
         {
             cmdGroup << cmd;
-            if ( !m_cmds.isEmpty() && m_cmds.first()->groupable() && m_cmds.first()->commandname() == cmd->commandname() )
+            if ( !m_cmds.isEmpty() && m_cmds.first()->groupable() && cmdGroup.count() < BULK_APPLY_SIZE )
                 cmd = m_cmds.takeFirst();
             else
                 break;
@@ -460,10 +464,8 @@ Source::reportSocialAttributesChanged( DatabaseCommand_SocialAction* action )
 void
 Source::updateTracks()
 {
-    {
-        DatabaseCommand* cmd = new DatabaseCommand_UpdateSearchIndex();
-        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
-    }
+    // AddFiles and DeleteFiles already updated the search index, only let everyone know
+    Database::instance()->notifyIndexChanged();
 
     {
         // Re-calculate local db stats
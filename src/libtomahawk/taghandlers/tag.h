@@ -33,6 +33,7 @@ class DLLEXPORT Tag
 {
 public:
     static Tag *fromFile( const TagLib::FileRef &f );
+    virtual ~Tag() {}
 
     //getter-setters for common TagLib items
     virtual QString title() const { return TStringToQString( m_tag->title() ).trimmed(); }
@@ -21,6 +21,7 @@
 #include "tomahawksettings.h"
 
 #include <QDir>
+#include <QThread>
 
 #include "sip/SipHandler.h"
 #include "playlistinterface.h"
@@ -488,6 +489,21 @@ TomahawkSettings::setScannerTime( uint time )
 }
 
 
+uint
+TomahawkSettings::scannerThreads() const
+{
+    // tag reading is mostly bound by i/o latency, so use more threads than cores
+    return value( "scanner/readerthreads", qMax( 4, QThread::idealThreadCount() * 2 ) ).toUInt();
+}
+
+
+void
+TomahawkSettings::setScannerThreads( uint threads )
+{
+    setValue( "scanner/readerthreads", threads );
+}
+
+
 bool
 TomahawkSettings::watchForChanges() const
 {
@@ -502,6 +518,34 @@ TomahawkSettings::setWatchForChanges( bool watch )
 }
 
 
+bool
+TomahawkSettings::dbConnectionPerWorker() const
+{
+    return value( "database/connectionperworker", true ).toBool();
+}
+
+
+void
+TomahawkSettings::setDbConnectionPerWorker( bool enable )
+{
+    setValue( "database/connectionperworker", enable );
+}
+
+
+uint
+TomahawkSettings::resolveRefreshRate() const
+{
+    return value( "resolvers/refreshrate", 200 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setResolveRefreshRate( uint rate )
+{
+    setValue( "resolvers/refreshrate", rate );
+}
+
+
 bool
 TomahawkSettings::httpEnabled() const
 {
@@ -516,6 +560,34 @@ TomahawkSettings::setHttpEnabled( bool enable )
 }
 
 
+uint
+TomahawkSettings::uploadRate() const
+{
+    return value( "network/uploadrate", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setUploadRate( uint kbps )
+{
+    setValue( "network/uploadrate", kbps );
+}
+
+
+uint
+TomahawkSettings::peerUploadRate() const
+{
+    return value( "network/peeruploadrate", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setPeerUploadRate( uint kbps )
+{
+    setValue( "network/peeruploadrate", kbps );
+}
+
+
 bool
 TomahawkSettings::crashReporterEnabled() const
 {
@@ -52,6 +52,8 @@ public:
     bool hasScannerPaths() const;
     uint scannerTime() const;
     void setScannerTime( uint time );
+    uint scannerThreads() const; /// number of threads reading tags during a scan
+    void setScannerThreads( uint threads );
     uint infoSystemCacheVersion() const;
     void setInfoSystemCacheVersion( uint version );
 
@@ -61,6 +63,14 @@ public:
     bool acceptedLegalWarning() const;
     void setAcceptedLegalWarning( bool accept );
 
+    /// Database settings
+    bool dbConnectionPerWorker() const; /// true by default
+    void setDbConnectionPerWorker( bool enable );
+
+    /// Resolver settings
+    uint resolveRefreshRate() const; /// queries per second re-resolved after the index or the resolvers changed
+    void setResolveRefreshRate( uint rate );
+
     /// UI settings
     QByteArray mainWindowGeometry() const;
     void setMainWindowGeometry( const QByteArray& geom );
@@ -131,6 +141,12 @@ public:
     bool httpEnabled() const; /// true by default
     void setHttpEnabled( bool enable );
 
+    // upload caps for streams to peers, in KB/s. 0 means unlimited
+    uint uploadRate() const; /// all streams together
+    void setUploadRate( uint kbps );
+    uint peerUploadRate() const; /// all streams to one peer
+    void setPeerUploadRate( uint kbps );
+
     bool crashReporterEnabled() const; /// true by default
     void setCrashReporterEnabled( bool enable );
 
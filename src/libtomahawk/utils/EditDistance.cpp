@@ -0,0 +1,231 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EditDistance.h"
+
+#include <QtCore/QtAlgorithms>
+
+#define WORD_SIZE 64
+
+using namespace TomahawkUtils;
+
+
+static bool
+peqLessThan( const QPair< ushort, quint64 >& left, const QPair< ushort, quint64 >& right )
+{
+    return left.first < right.first;
+}
+
+
+EditPattern::EditPattern()
+{
+}
+
+
+EditPattern::EditPattern( const QString& pattern )
+    : m_pattern( pattern )
+{
+    if ( m_pattern.length() > WORD_SIZE )
+        return;
+
+    for ( int i = 0; i < m_pattern.length(); i++ )
+    {
+        const QPair< ushort, quint64 > key( m_pattern.at( i ).unicode(), 0 );
+        QVector< QPair< ushort, quint64 > >::iterator it = qLowerBound( m_peq.begin(), m_peq.end(), key, peqLessThan );
+        if ( it == m_peq.end() || it->first != key.first )
+            it = m_peq.insert( it, key );
+
+        it->second |= Q_UINT64_C( 1 ) << i;
+    }
+}
+
+
+quint64
+EditPattern::peq( ushort c ) const
+{
+    const QPair< ushort, quint64 > key( c, 0 );
+    QVector< QPair< ushort, quint64 > >::const_iterator it = qLowerBound( m_peq.constBegin(), m_peq.constEnd(), key, peqLessThan );
+    if ( it == m_peq.constEnd() || it->first != c )
+        return 0;
+
+    return it->second;
+}
+
+
+int
+EditPattern::distance( const QString& text, int maxDistance ) const
+{
+    const int m = m_pattern.length();
+    const int n = text.length();
+
+    if ( m == 0 )
+        return n;
+    if ( n == 0 )
+        return m;
+    if ( maxDistance >= 0 && qAbs( m - n ) > maxDistance )
+        return qAbs( m - n );
+    if ( m > WORD_SIZE )
+        return distance( m_pattern, text, maxDistance );
+
+    // bit i of vp / vn: the vertical delta between rows i and i + 1 of the current column is +1 / -1
+    const quint64 last = Q_UINT64_C( 1 ) << ( m - 1 );
+    quint64 vp = ~Q_UINT64_C( 0 );
+    quint64 vn = 0;
+    quint64 d0 = 0;
+    quint64 prevEq = 0;
+    int score = m;
+
+    const QChar* t = text.constData();
+    for ( int j = 0; j < n; j++ )
+    {
+        const quint64 eq = peq( t[ j ].unicode() );
+
+        // diagonal zero-deltas, including the ones a transposition of two adjacent characters
+        // produces. the first two characters of either string are never transposed
+        const quint64 tr = ( j > 1 ) ? ( ( ( ~d0 & eq ) << 1 ) & prevEq & ~Q_UINT64_C( 3 ) ) : 0;
+        d0 = ( ( ( eq & vp ) + vp ) ^ vp ) | eq | vn | tr;
+
+        const quint64 hp = vn | ~( d0 | vp );
+        const quint64 hn = vp & d0;
+
+        if ( hp & last )
+            score++;
+        else if ( hn & last )
+            score--;
+
+        // the distance can shrink by at most one per remaining character of text
+        if ( maxDistance >= 0 && score - ( n - j - 1 ) > maxDistance )
+            return score - ( n - j - 1 );
+
+        // the first row grows by one per column, so a +1 shifts in at the bottom
+        const quint64 x = ( hp << 1 ) | 1;
+        vn = x & d0;
+        vp = ( hn << 1 ) | ~( x | d0 );
+        prevEq = eq;
+    }
+
+    return score;
+}
+
+
+int
+EditPattern::distance( const QString& source, const QString& target, int maxDistance )
+{
+    const int n = source.length();
+    const int m = target.length();
+
+    if ( n == 0 )
+        return m;
+    if ( m == 0 )
+        return n;
+
+    // only the last three rows are needed for transpositions
+    QVector< int > prev2( m + 1 ), prev( m + 1 ), row( m + 1 );
+    for ( int j = 0; j <= m; j++ )
+        prev[ j ] = j;
+    int prevMin = 0;
+
+    for ( int i = 1; i <= n; i++ )
+    {
+        const QChar s_i = source.at( i - 1 );
+        row[ 0 ] = i;
+        int rowMin = i;
+
+        for ( int j = 1; j <= m; j++ )
+        {
+            const QChar t_j = target.at( j - 1 );
+            const int cost = ( s_i == t_j ) ? 0 : 1;
+
+            int cell = qMin( prev[ j ] + 1, row[ j - 1 ] + 1 );
+            cell = qMin( cell, prev[ j - 1 ] + cost );
+
+            if ( i > 2 && j > 2 && s_i == target.at( j - 2 ) && source.at( i - 2 ) == t_j )
+                cell = qMin( cell, prev2[ j - 2 ] + 1 );
+
+            row[ j ] = cell;
+            rowMin = qMin( rowMin, cell );
+        }
+
+        // a transposition skips one row at most, so every path to the end crosses
+        // one of the last two, and costs can only grow along it
+        if ( maxDistance >= 0 && rowMin > maxDistance && prevMin > maxDistance )
+            return qMin( rowMin, prevMin );
+        prevMin = rowMin;
+
+        qSwap( prev2, prev );
+        qSwap( prev, row );
+    }
+
+    return prev[ m ];
+}
+
+
+int
+EditPattern::referenceDistance( const QString& source, const QString& target )
+{
+    const int n = source.length();
+    const int m = target.length();
+
+    if ( n == 0 )
+        return m;
+    if ( m == 0 )
+        return n;
+
+    typedef QVector< QVector<int> > Tmatrix;
+    Tmatrix matrix( n + 1, QVector<int>( m + 1 ) );
+
+    for ( int i = 0; i <= n; i++ )
+        matrix[i][0] = i;
+    for ( int j = 0; j <= m; j++ )
+        matrix[0][j] = j;
+
+    for ( int i = 1; i <= n; i++ )
+    {
+        const QChar s_i = source[i - 1];
+
+        for ( int j = 1; j <= m; j++ )
+        {
+            const QChar t_j = target[j - 1];
+            const int cost = ( s_i == t_j ) ? 0 : 1;
+
+            const int above = matrix[i - 1][j];
+            const int left = matrix[i][j - 1];
+            const int diag = matrix[i - 1][j - 1];
+
+            int cell = ( ( ( left + 1 ) > ( diag + cost ) ) ? diag + cost : left + 1 );
+            if ( above + 1 < cell )
+                cell = above + 1;
+
+            // Cover transposition, in addition to deletion, insertion and substitution.
+            // This step is taken from: Berghel, Hal ; Roach, David : "An Extension of
+            // Ukkonen's Enhanced Dynamic Programming ASM Algorithm"
+            // (http://www.acm.org/~hlb/publications/asm/asm.html)
+            if ( i > 2 && j > 2 )
+            {
+                int trans = matrix[i - 2][j - 2] + 1;
+
+                if ( source[ i - 2 ] != t_j ) trans++;
+                if ( s_i != target[ j - 2 ] ) trans++;
+                if ( cell > trans ) cell = trans;
+            }
+            matrix[i][j] = cell;
+        }
+    }
+
+    return matrix[n][m];
+}
@@ -0,0 +1,74 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EDITDISTANCE_H
+#define EDITDISTANCE_H
+
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "dllmacro.h"
+
+namespace TomahawkUtils
+{
+
+/**
+ * A string prepared for computing its edit distance to many other strings.
+ * The distance counts insertions, deletions, substitutions and transpositions of
+ * adjacent characters (optimal string alignment), except that the first two characters
+ * of either string can't be transposed, as in the original implementation the result
+ * scores were tuned with (see referenceDistance()). Patterns of up to 64 characters
+ * use Hyyrö's bit-parallel formulation of Myers' algorithm, longer ones fall back
+ * to the dynamic programming matrix.
+ */
+class DLLEXPORT EditPattern
+{
+public:
+    EditPattern();
+    explicit EditPattern( const QString& pattern );
+
+    QString pattern() const { return m_pattern; }
+    int length() const { return m_pattern.length(); }
+    bool isEmpty() const { return m_pattern.isEmpty(); }
+
+    /**
+     * Edit distance between the pattern and text. With a non-negative maxDistance the
+     * computation stops as soon as the distance is known to exceed it, the result is
+     * then some value larger than maxDistance but not necessarily the exact distance.
+     */
+    int distance( const QString& text, int maxDistance = -1 ) const;
+
+    /// The same distance with the dynamic programming matrix, keeping only the last rows.
+    static int distance( const QString& source, const QString& target, int maxDistance );
+
+    /// The original full matrix implementation, kept to check the faster ones against.
+    static int referenceDistance( const QString& source, const QString& target );
+
+private:
+    quint64 peq( ushort c ) const;
+
+    QString m_pattern;
+
+    // bitmask of the positions each character of the pattern occurs at, sorted by character
+    QVector< QPair< ushort, quint64 > > m_peq;
+};
+
+}
+
+#endif // EDITDISTANCE_H
@@ -0,0 +1,141 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchKey.h"
+
+
+namespace TomahawkUtils
+{
+
+static inline void
+appendFolded( QString& key, const QChar& c, bool& inWord )
+{
+    if ( c.category() == QChar::Mark_NonSpacing )
+        return;
+
+    if ( !c.isLetterOrNumber() )
+    {
+        inWord = false;
+        return;
+    }
+
+    if ( !inWord )
+        key += QLatin1Char( ' ' );
+    key += c.toCaseFolded();
+    inWord = true;
+}
+
+
+QString
+searchKey( const QString& text )
+{
+    QString key;
+    key.reserve( text.length() + 1 );
+
+    bool inWord = false;
+    const QChar* c = text.constData();
+    const QChar* end = c + text.length();
+    for ( ; c != end; ++c )
+    {
+        const ushort u = c->unicode();
+        if ( u < 0x80 )
+        {
+            // plain ascii, most of any collection
+            if ( ( u >= 'a' && u <= 'z' ) || ( u >= '0' && u <= '9' ) )
+            {
+                if ( !inWord )
+                    key += QLatin1Char( ' ' );
+                key += *c;
+                inWord = true;
+            }
+            else if ( u >= 'A' && u <= 'Z' )
+            {
+                if ( !inWord )
+                    key += QLatin1Char( ' ' );
+                key += QChar( u + ( 'a' - 'A' ) );
+                inWord = true;
+            }
+            else
+                inWord = false;
+
+            continue;
+        }
+
+        // split accented letters into the base letter and its (dropped) marks
+        const QString decomposed = c->decomposition();
+        if ( decomposed.isEmpty() )
+            appendFolded( key, *c, inWord );
+        else
+        {
+            foreach ( const QChar& d, decomposed )
+                appendFolded( key, d, inWord );
+        }
+    }
+
+    return key;
+}
+
+
+QStringList
+searchTokens( const QString& pattern )
+{
+    QStringList tokens = searchKey( pattern ).split( QLatin1Char( ' ' ), QString::SkipEmptyParts );
+    for ( int i = 0; i < tokens.count(); i++ )
+        tokens[i].prepend( QLatin1Char( ' ' ) );
+
+    return tokens;
+}
+
+
+bool
+matchesSearchKey( const QString& key, const QStringList& tokens )
+{
+    foreach ( const QString& token, tokens )
+    {
+        if ( !key.contains( token ) )
+            return false;
+    }
+
+    return true;
+}
+
+
+bool
+narrowsSearch( const QStringList& tokens, const QStringList& previous )
+{
+    // every word we looked for before must still be looked for, or a longer one starting with it
+    foreach ( const QString& p, previous )
+    {
+        bool found = false;
+        foreach ( const QString& t, tokens )
+        {
+            if ( t.startsWith( p ) )
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if ( !found )
+            return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,49 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCHKEY_H
+#define SEARCHKEY_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "dllmacro.h"
+
+namespace TomahawkUtils
+{
+
+/**
+ * Filters match words by their beginning, ignoring case, accents and punctuation.
+ * Text is turned into a search key once: the case folded, diacritic free words of
+ * the text, each preceded by a space, so "Beyoncé - Halo" becomes " beyonce halo".
+ * Keys of several fields can simply be concatenated.
+ */
+DLLEXPORT QString searchKey( const QString& text );
+
+/// The words of a filter pattern, prepared to be looked up in search keys.
+DLLEXPORT QStringList searchTokens( const QString& pattern );
+
+/// Whether every token starts one of the words of key.
+DLLEXPORT bool matchesSearchKey( const QString& key, const QStringList& tokens );
+
+/// Whether everything matching tokens also matches previous, i.e. the filter only got narrower.
+DLLEXPORT bool narrowsSearch( const QStringList& tokens, const QStringList& previous );
+
+}
+
+#endif // SEARCHKEY_H
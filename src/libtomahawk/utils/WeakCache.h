@@ -0,0 +1,122 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEAKCACHE_H
+#define WEAKCACHE_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QWeakPointer>
+
+#define WEAKCACHE_SHARDS 16
+
+namespace TomahawkUtils
+{
+
+/**
+ * Interning table for objects with a database id. Only weak references are kept,
+ * so objects go away once nobody else uses them. Lookups are spread over several
+ * locks, so threads working on different ids rarely wait for each other.
+ */
+template< class T >
+class WeakCache
+{
+public:
+    struct Stats
+    {
+        Stats() : hits( 0 ), misses( 0 ), evictions( 0 ), size( 0 ) {}
+
+        quint64 hits, misses, evictions;
+        int size;
+    };
+
+    /// the live object for id, or a null pointer
+    QSharedPointer< T > value( unsigned int id )
+    {
+        Shard& s = shard( id );
+        QMutexLocker lock( &s.mutex );
+
+        QSharedPointer< T > p = s.objects.value( id ).toStrongRef();
+        if ( p.isNull() )
+            s.stats.misses++;
+        else
+            s.stats.hits++;
+
+        return p;
+    }
+
+    /// stores p for id, unless another thread was quicker. returns the object to use
+    QSharedPointer< T > insert( unsigned int id, const QSharedPointer< T >& p )
+    {
+        Shard& s = shard( id );
+        QMutexLocker lock( &s.mutex );
+
+        QSharedPointer< T > existing = s.objects.value( id ).toStrongRef();
+        if ( !existing.isNull() )
+            return existing;
+
+        s.objects.insert( id, p.toWeakRef() );
+        return p;
+    }
+
+    /// drops the entry for id, if its object is gone. call this from T's destructor
+    void purge( unsigned int id )
+    {
+        Shard& s = shard( id );
+        QMutexLocker lock( &s.mutex );
+
+        typename QHash< unsigned int, QWeakPointer< T > >::iterator it = s.objects.find( id );
+        if ( it != s.objects.end() && it.value().isNull() )
+        {
+            s.objects.erase( it );
+            s.stats.evictions++;
+        }
+    }
+
+    Stats stats()
+    {
+        Stats total;
+        for ( int i = 0; i < WEAKCACHE_SHARDS; i++ )
+        {
+            QMutexLocker lock( &m_shards[ i ].mutex );
+            total.hits += m_shards[ i ].stats.hits;
+            total.misses += m_shards[ i ].stats.misses;
+            total.evictions += m_shards[ i ].stats.evictions;
+            total.size += m_shards[ i ].objects.count();
+        }
+
+        return total;
+    }
+
+private:
+    struct Shard
+    {
+        QMutex mutex;
+        QHash< unsigned int, QWeakPointer< T > > objects;
+        Stats stats;
+    };
+
+    Shard& shard( unsigned int id ) { return m_shards[ id % WEAKCACHE_SHARDS ]; }
+
+    Shard m_shards[ WEAKCACHE_SHARDS ];
+};
+
+} // ns
+
+#endif // WEAKCACHE_H
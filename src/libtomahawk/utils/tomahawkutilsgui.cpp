@@ -31,6 +31,7 @@
 #include <QtGui/QPalette>
 #include <QtGui/QApplication>
 #include <QtGui/QWidget>
+#include <QtCore/QCache>
 #include <QStyleOption>
 
 #ifdef Q_WS_X11
@@ -44,6 +45,9 @@
 #endif
 
 
+// in KB
+#define COVER_CACHE_SIZE ( 32 * 1024 )
+
 namespace TomahawkUtils
 {
 static int s_headerHeight = 0;
@@ -385,6 +389,56 @@ defaultPixmap( ImageType type, ImageMode mode, const QSize& size )
 }
 
 
+QPixmap
+cachedCover( const QString& key, const QByteArray& data, const QSize& size )
+{
+    // only ever used from the GUI thread, like all pixmaps. costs are in KB
+    static QCache< QString, QPixmap > s_covers( COVER_CACHE_SIZE );
+    static quint64 s_hits = 0, s_misses = 0, s_evictions = 0;
+
+    if ( key.isEmpty() || data.isEmpty() )
+        return QPixmap();
+
+    const QString sizeKey = size.isEmpty() ? key : QString( "%1-%2" ).arg( key ).arg( size.width() );
+    if ( QPixmap* cover = s_covers.object( sizeKey ) )
+    {
+        s_hits++;
+        return *cover;
+    }
+    s_misses++;
+
+    const int count = s_covers.count();
+    int added = 0;
+    QPixmap cover;
+    if ( QPixmap* original = s_covers.object( key ) )
+    {
+        cover = *original;
+    }
+    else
+    {
+        if ( !cover.loadFromData( data ) )
+            return cover;
+
+        s_covers.insert( key, new QPixmap( cover ), qMax( 1, cover.width() * cover.height() * cover.depth() / 8 / 1024 ) );
+        added++;
+    }
+
+    if ( sizeKey != key )
+    {
+        cover = cover.scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+        s_covers.insert( sizeKey, new QPixmap( cover ), qMax( 1, cover.width() * cover.height() * cover.depth() / 8 / 1024 ) );
+        added++;
+    }
+
+    s_evictions += qMax( 0, count + added - s_covers.count() );
+    if ( s_misses % 1000 == 0 )
+        tDebug( LOGVERBOSE ) << "Cover cache: hits" << s_hits << "misses" << s_misses << "evictions" << s_evictions
+                             << "size" << s_covers.totalCost() << "KB";
+
+    return cover;
+}
+
+
 void
 prepareStyleOption( QStyleOptionViewItemV4* option, const QModelIndex& index, TrackModelItem* item )
 {
@@ -55,6 +55,9 @@ namespace TomahawkUtils
 
     DLLEXPORT QPixmap defaultPixmap( ImageType type, ImageMode mode = TomahawkUtils::Original, const QSize& size = QSize( 0, 0 ) );
 
+    /// decodes and scales image data, keeping the results in a cache of limited size. key must identify data
+    DLLEXPORT QPixmap cachedCover( const QString& key, const QByteArray& data, const QSize& size );
+
     DLLEXPORT void prepareStyleOption( QStyleOptionViewItemV4* option, const QModelIndex& index, TrackModelItem* item );
 
 }
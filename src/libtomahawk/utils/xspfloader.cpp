@@ -243,10 +243,7 @@ XSPFLoader::gotBody()
     }
 
     if ( m_autoResolve )
-    {
-        for ( int i = m_entries.size() - 1; i >= 0; i-- )
-            Pipeline::instance()->resolve( m_entries[ i ] );
-    }
+        Pipeline::instance()->resolve( m_entries, Pipeline::Background );
 
     if ( origTitle.isEmpty() && m_entries.isEmpty() )
     {
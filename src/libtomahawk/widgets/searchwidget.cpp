@@ -23,6 +23,7 @@
 #include <QPushButton>
 #include <QDialogButtonBox>
 
+#include "pipeline.h"
 #include "sourcelist.h"
 #include "viewmanager.h"
 #include "dynamic/widgets/LoadingSpinner.h"
@@ -93,6 +94,8 @@ SearchWidget::SearchWidget( const QString& search, QWidget* parent )
 
 SearchWidget::~SearchWidget()
 {
+    if ( Tomahawk::Pipeline::instance() )
+        Tomahawk::Pipeline::instance()->cancel( m_queries );
     delete ui;
 }
 
@@ -37,19 +37,59 @@
 using namespace Tomahawk;
 
 
+class TagReader : public QRunnable
+{
+public:
+    TagReader( MusicScanner* scanner, unsigned int seq, const QFileInfo& fi, const QString& mimetype )
+        : m_scanner( scanner )
+        , m_seq( seq )
+        , m_fi( fi )
+        , m_mimetype( mimetype )
+    {}
+
+    void run()
+    {
+        QVariant m;
+        if ( !m_scanner->isAborting() )
+            m = MusicScanner::readFile( m_fi, m_mimetype );
+
+        QMetaObject::invokeMethod( m_scanner, "fileRead", Qt::QueuedConnection,
+                                   Q_ARG( unsigned int, m_seq ),
+                                   Q_ARG( QVariant, m ),
+                                   Q_ARG( QString, m_fi.canonicalFilePath() ),
+                                   Q_ARG( qlonglong, m_fi.size() ) );
+    }
+
+private:
+    MusicScanner* m_scanner;
+    unsigned int m_seq;
+    QFileInfo m_fi;
+    QString m_mimetype;
+};
+
+
 void
 DirLister::go()
 {
     foreach ( const QString& dir, m_dirs )
     {
         m_opcount++;
-        QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, QDir( dir, 0 ) ), Q_ARG( int, 0 ) );
+        QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, QDir( dir, 0 ) ), Q_ARG( int, 0 ), Q_ARG( bool, true ) );
     }
+
+    foreach ( const QString& dir, m_flatDirs )
+    {
+        m_opcount++;
+        QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, QDir( dir, 0 ) ), Q_ARG( int, 0 ), Q_ARG( bool, false ) );
+    }
+
+    if ( m_opcount == 0 )
+        emit finished();
 }
 
 
 void
-DirLister::scanDir( QDir dir, int depth )
+DirLister::scanDir( QDir dir, int depth, bool recursive )
 {
     if ( isDeleting() )
     {
@@ -73,22 +113,44 @@ DirLister::scanDir( QDir dir, int depth )
     }
 
     QFileInfoList dirs;
+    const QString path = dir.canonicalPath();
+    m_scannedDirs << path;
+
+    // A dir's mtime only changes when entries get added, removed or renamed in there.
+    // If it didn't, its files needn't be listed - the scanner checks the mtimes of the files
+    // it knows in there instead. Its subdirs are still descended into, they have their own mtimes.
+    // Dirs modified just now aren't remembered, they could still change within the same second.
+    const unsigned int mtime = QFileInfo( path ).lastModified().toUTC().toTime_t();
+    if ( mtime + 1 < QDateTime::currentDateTime().toTime_t() )
+        m_newMtimes.insert( path, mtime );
+
+    // flat dirs were reported as changed, always list those
+    if ( recursive && m_dirMtimes.contains( path ) && m_dirMtimes.value( path ) == mtime )
+    {
+        tDebug( LOGVERBOSE ) << "DirLister::scanDir unchanged, skipping files in:" << path;
+        emit dirUnchanged( path );
+    }
+    else
+    {
+        dir.setFilter( QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
+        dir.setSorting( QDir::Name );
+        dirs = dir.entryInfoList();
 
-    dir.setFilter( QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
-    dir.setSorting( QDir::Name );
-    dirs = dir.entryInfoList();
-
-    foreach ( const QFileInfo& di, dirs )
-        emit fileToScan( di );
-
-    dir.setFilter( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
-    dirs = dir.entryInfoList();
+        foreach ( const QFileInfo& di, dirs )
+            emit fileToScan( di );
+    }
 
-    foreach ( const QFileInfo& di, dirs )
+    if ( recursive )
     {
-        const QString canonical = di.canonicalFilePath();
-        m_opcount++;
-        QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, di.canonicalFilePath() ), Q_ARG( int, depth + 1 ) );
+        dir.setFilter( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
+        dirs = dir.entryInfoList();
+
+        foreach ( const QFileInfo& di, dirs )
+        {
+            const QString canonical = di.canonicalFilePath();
+            m_opcount++;
+            QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, di.canonicalFilePath() ), Q_ARG( int, depth + 1 ), Q_ARG( bool, true ) );
+        }
     }
 
     m_opcount--;
@@ -100,12 +162,24 @@ DirLister::scanDir( QDir dir, int depth )
 }
 
 
-MusicScanner::MusicScanner( const QStringList& dirs, quint32 bs )
+MusicScanner::MusicScanner( const QStringList& dirs, quint32 bs, const QStringList& flatDirs )
     : QObject()
     , m_dirs( dirs )
+    , m_flatDirs( flatDirs )
+    , m_unchangedDirs( 0 )
     , m_batchsize( bs )
     , m_dirListerThreadController( 0 )
+    , m_readerPool( new QThreadPool( this ) )
+    , m_nextSeq( 0 )
+    , m_mergeSeq( 0 )
+    , m_listerFinished( false )
+    , m_aborting( false )
+    , m_filesRead( 0 )
+    , m_bytesRead( 0 )
 {
+    m_readerPool->setMaxThreadCount( qMax( 1, (int)TomahawkSettings::instance()->scannerThreads() ) );
+    tDebug() << Q_FUNC_INFO << "Using" << m_readerPool->maxThreadCount() << "tag reader threads";
+
     m_ext2mime.insert( "mp3", TomahawkUtils::extensionToMimetype( "mp3" ) );
     m_ext2mime.insert( "ogg", TomahawkUtils::extensionToMimetype( "ogg" ) );
     m_ext2mime.insert( "oga", TomahawkUtils::extensionToMimetype( "oga" ) );
@@ -122,6 +196,10 @@ MusicScanner::~MusicScanner()
 {
     tDebug() << Q_FUNC_INFO;
 
+    // outstanding readers skip their files, but they still hold a pointer to us
+    m_aborting = true;
+    m_readerPool->waitForDone();
+
     if ( !m_dirLister.isNull() )
     {
         m_dirListerThreadController->quit();;
@@ -138,8 +216,12 @@ void
 MusicScanner::startScan()
 {
     tDebug( LOGVERBOSE ) << "Loading mtimes...";
-    m_scanned = m_skipped = m_cmdQueue = 0;
+    m_scanned = m_skipped = m_cmdQueue = m_unchangedDirs = 0;
+    m_nextSeq = m_mergeSeq = m_filesRead = 0;
+    m_bytesRead = 0;
+    m_listerFinished = false;
     m_skippedFiles.clear();
+    m_scanTime.start();
 
     SourceList::instance()->getLocal()->scanningProgress( m_scanned );
 
@@ -147,7 +229,12 @@ MusicScanner::startScan()
     //FIXME: For multiple collection support make sure the right prefix gets passed in...or not...
     //bear in mind that simply passing in the top-level of a defined collection means it will not return items that need
     //to be removed that aren't in that root any longer -- might have to do the filtering in setMTimes based on strings
-    DatabaseCommand_FileMtimes *cmd = new DatabaseCommand_FileMtimes();
+    DatabaseCommand_FileMtimes *cmd;
+    if ( m_flatDirs.isEmpty() )
+        cmd = new DatabaseCommand_FileMtimes();
+    else
+        cmd = new DatabaseCommand_FileMtimes( m_dirs + m_flatDirs );
+
     connect( cmd, SIGNAL( done( QMap< QString, QMap< unsigned int, unsigned int > > ) ),
                     SLOT( setFileMtimes( QMap< QString, QMap< unsigned int, unsigned int > > ) ) );
 
@@ -161,10 +248,83 @@ MusicScanner::setFileMtimes( const QMap< QString, QMap< unsigned int, unsigned i
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << m.count();
     m_filemtimes = m;
+
+    if ( !m_flatDirs.isEmpty() )
+    {
+        // files in subdirs of a flat dir aren't listed, so they must not be considered
+        // for deletion. Unless that subdir is gone, which makes its files gone too.
+        QMutableMapIterator< QString, QMap< unsigned int, unsigned int > > it( m_filemtimes );
+        while ( it.hasNext() )
+        {
+            it.next();
+            const QString path = it.key().mid( QString( "file://" ).length() );
+            const QString parent = QFileInfo( path ).path();
+
+            bool keep = m_flatDirs.contains( parent ) || !QFileInfo( parent ).exists();
+            foreach ( const QString& dir, m_dirs )
+            {
+                if ( keep )
+                    break;
+                keep = path.startsWith( dir + "/" );
+            }
+
+            if ( !keep )
+                it.remove();
+        }
+    }
+
+    // then the dir mtimes, to skip listing dirs that didn't change
+    DatabaseCommand_DirMtimes *cmd;
+    if ( m_flatDirs.isEmpty() )
+        cmd = new DatabaseCommand_DirMtimes();
+    else
+        cmd = new DatabaseCommand_DirMtimes( m_dirs + m_flatDirs );
+
+    connect( cmd, SIGNAL( done( QMap< QString, unsigned int > ) ),
+                    SLOT( setDirMtimes( QMap< QString, unsigned int > ) ) );
+
+    Database::instance()->enqueue( QSharedPointer< DatabaseCommand >( cmd ) );
+}
+
+
+void
+MusicScanner::setDirMtimes( const QMap< QString, unsigned int >& m )
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << m.count();
+    m_dirmtimes = m;
+
     scan();
 }
 
 
+void
+MusicScanner::dirUnchanged( const QString& dir )
+{
+    m_unchangedDirs++;
+
+    // the files directly in dir didn't get listed. Editing tags in place doesn't touch the dir
+    // mtime though, so still compare the mtimes of the files we know in there.
+    // All files below dir are sorted right after it, skip those in its subdirs.
+    const QString prefix = "file://" + dir + "/";
+    QStringList known;
+    QMap< QString, QMap< unsigned int, unsigned int > >::const_iterator it = m_filemtimes.lowerBound( prefix );
+    for ( ; it != m_filemtimes.constEnd() && it.key().startsWith( prefix ); ++it )
+    {
+        if ( it.key().indexOf( '/', prefix.length() ) == -1 )
+            known << it.key().mid( QString( "file://" ).length() );
+    }
+
+    // scanFile() forgets unmodified files and re-reads modified ones. Files that are gone stay
+    // in m_filemtimes and get deleted once the scan is finished.
+    foreach ( const QString& path, known )
+    {
+        const QFileInfo fi( path );
+        if ( fi.exists() )
+            scanFile( fi );
+    }
+}
+
+
 void
 MusicScanner::scan()
 {
@@ -175,11 +335,13 @@ MusicScanner::scan()
 
     m_dirListerThreadController = new QThread( this );
 
-    m_dirLister = QWeakPointer< DirLister >( new DirLister( m_dirs ) );
+    m_dirLister = QWeakPointer< DirLister >( new DirLister( m_dirs, m_flatDirs, m_dirmtimes ) );
     m_dirLister.data()->moveToThread( m_dirListerThreadController );
 
     connect( m_dirLister.data(), SIGNAL( fileToScan( QFileInfo ) ),
                                    SLOT( scanFile( QFileInfo ) ), Qt::QueuedConnection );
+    connect( m_dirLister.data(), SIGNAL( dirUnchanged( QString ) ),
+                                   SLOT( dirUnchanged( QString ) ), Qt::QueuedConnection );
 
     // queued, so will only fire after all dirs have been scanned:
     connect( m_dirLister.data(), SIGNAL( finished() ),
@@ -195,6 +357,23 @@ MusicScanner::listerFinished()
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
 
+    // wait for the tag readers to hand back everything the lister found
+    m_listerFinished = true;
+    if ( m_mergeSeq == m_nextSeq )
+        finishScan();
+}
+
+
+void
+MusicScanner::finishScan()
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
+    tDebug( LOGINFO ) << "Tag reading finished:" << m_filesRead << "files," << m_bytesRead << "bytes,"
+                      << filesPerSecond() << "files/sec," << m_unchangedDirs << "unchanged dirs skipped";
+
+    if ( !m_dirLister.isNull() )
+        emit dirsScanned( m_dirLister.data()->scannedDirs() );
+
     // any remaining stuff that wasnt emitted as a batch:
     foreach( const QString& key, m_filemtimes.keys() )
         m_filesToDelete << m_filemtimes[ key ].keys().first();
@@ -212,7 +391,13 @@ MusicScanner::listerFinished()
         foreach ( const QString& s, m_skippedFiles )
             tDebug( LOGEXTRA ) << s;
     }
-    else
+
+    // saved after the files, so a dir is never skipped before its files made it into the db.
+    // A partial scan only saw some dirs, keep the others around.
+    if ( !m_dirLister.isNull() && !m_dirLister.data()->isDeleting() && !m_dirLister.data()->newMtimes().isEmpty() )
+        executeCommand( QSharedPointer<DatabaseCommand>( new DatabaseCommand_DirMtimes( m_dirLister.data()->newMtimes(), m_flatDirs.isEmpty() ) ) );
+
+    if ( m_cmdQueue == 0 )
         cleanup();
 }
 
@@ -287,37 +472,71 @@ MusicScanner::scanFile( const QFileInfo& fi )
         m_filemtimes.remove( "file://" + fi.canonicalFilePath() );
     }
 
+    const QString suffix = fi.suffix().toLower();
+    if ( !m_ext2mime.contains( suffix ) )
+        return; // invalid extension
+
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Scanning file:" << fi.canonicalFilePath();
-    QVariant m = readFile( fi );
-    if ( m.toMap().isEmpty() )
-        return;
+    m_readerPool->start( new TagReader( this, m_nextSeq++, fi, m_ext2mime.value( suffix ) ) );
+}
+
 
-    m_scannedfiles << m;
-    if ( m_batchsize != 0 && (quint32)m_scannedfiles.length() >= m_batchsize )
+void
+MusicScanner::fileRead( unsigned int seq, const QVariant& m, const QString& path, qlonglong bytes )
+{
+    m_filesRead++;
+    m_bytesRead += bytes;
+    m_readFiles.insert( seq, qMakePair( m, path ) );
+
+    if ( m_filesRead % 1000 == 0 )
+        tDebug( LOGINFO ) << "Scan rate:" << filesPerSecond() << "files/sec," << m_bytesRead << "bytes in" << m_filesRead << "files";
+
+    // merge results back in the order the lister found them
+    while ( m_readFiles.contains( m_mergeSeq ) )
     {
-        emit batchReady( m_scannedfiles, m_filesToDelete );
-        m_scannedfiles.clear();
-        m_filesToDelete.clear();
+        const QPair< QVariant, QString > file = m_readFiles.take( m_mergeSeq++ );
+        if ( file.first.toMap().isEmpty() )
+        {
+            m_skippedFiles << file.second;
+            m_skipped++;
+            continue;
+        }
+
+        if ( m_scanned )
+            if ( m_scanned % 3 == 0 )
+                SourceList::instance()->getLocal()->scanningProgress( m_scanned );
+        if ( m_scanned % 100 == 0 )
+            tDebug( LOGINFO ) << "Scan progress:" << m_scanned << file.second;
+
+        m_scanned++;
+        m_scannedfiles << file.first;
+        if ( m_batchsize != 0 && (quint32)m_scannedfiles.length() >= m_batchsize )
+        {
+            emit batchReady( m_scannedfiles, m_filesToDelete );
+            m_scannedfiles.clear();
+            m_filesToDelete.clear();
+        }
     }
+
+    if ( m_listerFinished && m_mergeSeq == m_nextSeq )
+        finishScan();
 }
 
 
-QVariant
-MusicScanner::readFile( const QFileInfo& fi )
+float
+MusicScanner::filesPerSecond() const
 {
-    const QString suffix = fi.suffix().toLower();
+    const int elapsed = m_scanTime.elapsed();
+    if ( elapsed <= 0 )
+        return 0.0;
 
-    if ( !m_ext2mime.contains( suffix ) )
-    {
-        return QVariantMap(); // invalid extension
-    }
+    return (float)m_filesRead * 1000.0 / (float)elapsed;
+}
 
-    if ( m_scanned )
-        if ( m_scanned % 3 == 0 )
-            SourceList::instance()->getLocal()->scanningProgress( m_scanned );
-    if ( m_scanned % 100 == 0 )
-        tDebug( LOGINFO ) << "Scan progress:" << m_scanned << fi.canonicalFilePath();
 
+QVariant
+MusicScanner::readFile( const QFileInfo& fi, const QString& mimetype )
+{
     #ifdef COMPLEX_TAGLIB_FILENAME
         const wchar_t *encodedName = reinterpret_cast< const wchar_t * >( fi.canonicalFilePath().utf16() );
     #else
@@ -327,16 +546,14 @@ MusicScanner::readFile( const QFileInfo& fi )
 
     TagLib::FileRef f( encodedName );
     if ( f.isNull() || !f.tag() )
-    {
-        m_skippedFiles << fi.canonicalFilePath();
-        m_skipped++;
         return QVariantMap();
-    }
 
     int bitrate = 0;
     int duration = 0;
 
     Tag *tag = Tag::fromFile( f );
+    if ( !tag )
+        return QVariantMap();
 
     if ( f.audioProperties() )
     {
@@ -351,12 +568,10 @@ MusicScanner::readFile( const QFileInfo& fi )
     if ( artist.isEmpty() || track.isEmpty() )
     {
         // FIXME: do some clever filename guessing
-        m_skippedFiles << fi.canonicalFilePath();
-        m_skipped++;
+        delete tag;
         return QVariantMap();
     }
 
-    QString mimetype = m_ext2mime.value( suffix );
     QString url( "file://%1" );
 
     QVariantMap m;
@@ -376,6 +591,6 @@ MusicScanner::readFile( const QFileInfo& fi )
     m["discnumber"]   = tag->discNumber();
     m["hash"]         = ""; // TODO
 
-    m_scanned++;
+    delete tag;
     return m;
 }
@@ -36,10 +36,12 @@
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QWeakPointer>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTime>
 #include <database/database.h>
 
 // descend dir tree comparing dir mtimes to last known mtime
-// emit signal for any dir with new content, so we can scan it.
+// list files of any dir with new content, so we can scan them.
 // finally, emit the list of new mtimes we observed.
 class DirLister : public QObject
 {
@@ -47,8 +49,9 @@ Q_OBJECT
 
 public:
 
-    DirLister( const QStringList& dirs )
-        : QObject(), m_dirs( dirs ), m_opcount( 0 ), m_deleting( false )
+    DirLister( const QStringList& dirs, const QStringList& flatDirs = QStringList(),
+               const QMap< QString, unsigned int >& dirMtimes = QMap< QString, unsigned int >() )
+        : QObject(), m_dirs( dirs ), m_flatDirs( flatDirs ), m_dirMtimes( dirMtimes ), m_opcount( 0 ), m_deleting( false )
     {
         qDebug() << Q_FUNC_INFO;
     }
@@ -61,16 +64,27 @@ public:
     bool isDeleting() { QMutexLocker locker( &m_deletingMutex ); return m_deleting; };
     void setIsDeleting() { QMutexLocker locker( &m_deletingMutex ); m_deleting = true; };
 
+    /// all directories visited, only safe to call once finished() was emitted
+    QStringList scannedDirs() const { return m_scannedDirs; }
+    /// mtimes of all directories visited, only safe to call once finished() was emitted
+    QMap< QString, unsigned int > newMtimes() const { return m_newMtimes; }
+
 signals:
     void fileToScan( QFileInfo );
+    /// the files directly inside dir were not listed, as its mtime didn't change. Their own mtimes still need checking
+    void dirUnchanged( const QString& dir );
     void finished();
 
 private slots:
     void go();
-    void scanDir( QDir dir, int depth );
+    void scanDir( QDir dir, int depth, bool recursive );
 
 private:
     QStringList m_dirs;
+    QStringList m_flatDirs; // only the files directly inside are listed, not subdirs
+    QStringList m_scannedDirs;
+    QMap< QString, unsigned int > m_dirMtimes;
+    QMap< QString, unsigned int > m_newMtimes;
 
     uint m_opcount;
     QMutex m_deletingMutex;
@@ -83,22 +97,41 @@ class MusicScanner : public QObject
 Q_OBJECT
 
 public:
-    MusicScanner( const QStringList& dirs, quint32 bs = 0 );
+    /**
+     * Scans dirs recursively and flatDirs without descending into their subdirs.
+     * If flatDirs are given, only files below those paths are considered for
+     * deletion instead of the whole local collection.
+     */
+    MusicScanner( const QStringList& dirs, quint32 bs = 0, const QStringList& flatDirs = QStringList() );
     ~MusicScanner();
 
+    /// Reads the tags of a single file, this is run on the tag-reader threads
+    static QVariant readFile( const QFileInfo& fi, const QString& mimetype );
+
+    bool isAborting() const { return m_aborting; }
+
+    // scan-rate counters, so the reader pool can be sized for the storage backend
+    unsigned int filesRead() const { return m_filesRead; }
+    qlonglong bytesRead() const { return m_bytesRead; }
+    float filesPerSecond() const;
+
 signals:
     //void fileScanned( QVariantMap );
     void finished();
     void batchReady( const QVariantList&, const QVariantList& );
+    void dirsScanned( const QStringList& dirs );
 
 private:
-    QVariant readFile( const QFileInfo& fi );
     void executeCommand( QSharedPointer< DatabaseCommand > cmd );
+    void finishScan();
 
 private slots:
     void listerFinished();
     void scanFile( const QFileInfo& fi );
+    void fileRead( unsigned int seq, const QVariant& m, const QString& path, qlonglong bytes );
     void setFileMtimes( const QMap< QString, QMap< unsigned int, unsigned int > >& m );
+    void setDirMtimes( const QMap< QString, unsigned int >& m );
+    void dirUnchanged( const QString& dir );
     void startScan();
     void scan();
     void cleanup();
@@ -107,12 +140,15 @@ private slots:
 
 private:
     QStringList m_dirs;
+    QStringList m_flatDirs;
     QMap<QString, QString> m_ext2mime; // eg: mp3 -> audio/mpeg
     unsigned int m_scanned;
     unsigned int m_skipped;
 
     QList<QString> m_skippedFiles;
     QMap<QString, QMap< unsigned int, unsigned int > > m_filemtimes;
+    QMap<QString, unsigned int> m_dirmtimes;
+    unsigned int m_unchangedDirs;
 
     unsigned int m_cmdQueue;
 
@@ -122,6 +158,19 @@ private:
 
     QWeakPointer< DirLister > m_dirLister;
     QThread* m_dirListerThreadController;
+
+    // tag reading happens on a pool of threads. Files get a sequence number when they
+    // are handed out and are merged back into the batches in that same order.
+    QThreadPool* m_readerPool;
+    unsigned int m_nextSeq;
+    unsigned int m_mergeSeq;
+    QMap< unsigned int, QPair< QVariant, QString > > m_readFiles;
+    bool m_listerFinished;
+    volatile bool m_aborting;
+
+    QTime m_scanTime;
+    unsigned int m_filesRead;
+    qlonglong m_bytesRead;
 };
 
 #endif
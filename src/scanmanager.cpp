@@ -22,6 +22,8 @@
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QTimer>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QDir>
 
 #include "musicscanner.h"
 #include "tomahawksettings.h"
@@ -34,6 +36,12 @@
 
 #include "utils/logger.h"
 
+// wait this long after the last change notification before rescanning (ms)
+#define WATCH_SETTLE_TIME 3000
+// while watching, the periodic scans still run this many times less often: directory
+// watches don't report files rewritten in place, e.g. when their tags get edited
+#define WATCHED_SCAN_FACTOR 10
+
 ScanManager* ScanManager::s_instance = 0;
 
 
@@ -48,9 +56,18 @@ ScanManager::ScanManager( QObject* parent )
     : QObject( parent )
     , m_musicScannerThreadController( 0 )
     , m_currScannerPaths()
+    , m_watchIncomplete( false )
 {
     s_instance = this;
 
+    m_watcher = new QFileSystemWatcher( this );
+    connect( m_watcher, SIGNAL( directoryChanged( QString ) ), SLOT( onDirectoryChanged( QString ) ) );
+
+    m_watchTimer = new QTimer( this );
+    m_watchTimer->setSingleShot( true );
+    m_watchTimer->setInterval( WATCH_SETTLE_TIME );
+    connect( m_watchTimer, SIGNAL( timeout() ), SLOT( runWatchScan() ) );
+
     m_scanTimer = new QTimer( this );
     m_scanTimer->setSingleShot( false );
     m_scanTimer->setInterval( TomahawkSettings::instance()->scannerTime() * 1000 );
@@ -91,7 +108,14 @@ ScanManager::onSettingsChanged()
     if ( !TomahawkSettings::instance()->watchForChanges() && m_scanTimer->isActive() )
         m_scanTimer->stop();
 
-    m_scanTimer->setInterval( TomahawkSettings::instance()->scannerTime() * 1000 );
+    if ( !TomahawkSettings::instance()->watchForChanges() && !m_watcher->directories().isEmpty() )
+    {
+        m_watcher->removePaths( m_watcher->directories() );
+        m_changedDirs.clear();
+        m_watchTimer->stop();
+    }
+
+    m_scanTimer->setInterval( scanInterval() );
 
     if ( TomahawkSettings::instance()->hasScannerPaths() &&
         m_currScannerPaths != TomahawkSettings::instance()->scannerPaths() )
@@ -194,13 +218,13 @@ ScanManager::runDirScan()
 
     if ( !m_musicScannerThreadController && m_scanner.isNull() ) //still running if these are not zero
     {
-        m_scanTimer->stop();
-        m_musicScannerThreadController = new QThread( this );
-        m_scanner = QWeakPointer< MusicScanner >( new MusicScanner( paths ) );
-        m_scanner.data()->moveToThread( m_musicScannerThreadController );
-        connect( m_scanner.data(), SIGNAL( finished() ), SLOT( scannerFinished() ) );
-        m_musicScannerThreadController->start( QThread::IdlePriority );
-        QMetaObject::invokeMethod( m_scanner.data(), "startScan" );
+        // a full scan re-adds watches for everything it finds
+        if ( !m_watcher->directories().isEmpty() )
+            m_watcher->removePaths( m_watcher->directories() );
+        m_changedDirs.clear();
+        m_watchIncomplete = false;
+
+        startScanner( new MusicScanner( paths ) );
     }
     else
     {
@@ -210,6 +234,121 @@ ScanManager::runDirScan()
 }
 
 
+void
+ScanManager::startScanner( MusicScanner* scanner )
+{
+    m_scanTimer->stop();
+    m_musicScannerThreadController = new QThread( this );
+    m_scanner = QWeakPointer< MusicScanner >( scanner );
+    m_scanner.data()->moveToThread( m_musicScannerThreadController );
+    connect( m_scanner.data(), SIGNAL( finished() ), SLOT( scannerFinished() ) );
+    connect( m_scanner.data(), SIGNAL( dirsScanned( QStringList ) ), SLOT( addWatches( QStringList ) ) );
+    m_musicScannerThreadController->start( QThread::IdlePriority );
+    QMetaObject::invokeMethod( m_scanner.data(), "startScan" );
+}
+
+
+bool
+ScanManager::isWatching() const
+{
+    return !m_watchIncomplete && !m_watcher->directories().isEmpty();
+}
+
+
+int
+ScanManager::scanInterval() const
+{
+    const int interval = TomahawkSettings::instance()->scannerTime() * 1000;
+    return isWatching() ? interval * WATCHED_SCAN_FACTOR : interval;
+}
+
+
+void
+ScanManager::addWatches( const QStringList& dirs )
+{
+    if ( !TomahawkSettings::instance()->watchForChanges() )
+        return;
+
+    const QSet< QString > watched = m_watcher->directories().toSet();
+    QStringList toWatch;
+    foreach ( const QString& dir, dirs )
+    {
+        if ( !watched.contains( dir ) )
+            toWatch << dir;
+    }
+
+    if ( toWatch.isEmpty() )
+        return;
+
+    m_watcher->addPaths( toWatch );
+
+    // e.g. when running into the inotify watch limit; keep the periodic full scans then
+    if ( m_watcher->directories().count() < watched.count() + toWatch.count() )
+    {
+        tLog() << "Could not watch all" << watched.count() + toWatch.count() << "directories for changes, only"
+               << m_watcher->directories().count() << "- falling back to periodic scans";
+        m_watchIncomplete = true;
+    }
+    else
+        tDebug() << "Watching" << m_watcher->directories().count() << "directories for changes";
+}
+
+
+void
+ScanManager::onDirectoryChanged( const QString& path )
+{
+    if ( !TomahawkSettings::instance()->watchForChanges() )
+        return;
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << path;
+    m_changedDirs << path;
+    m_watchTimer->start();
+}
+
+
+void
+ScanManager::runWatchScan()
+{
+    if ( m_changedDirs.isEmpty() )
+        return;
+
+    if ( !Database::instance() || !Database::instance()->isReady() ||
+         m_musicScannerThreadController || !m_scanner.isNull() )
+    {
+        // try again once the current scan is done
+        m_watchTimer->start();
+        return;
+    }
+
+    // changed dirs are rescanned flat, new subdirs in there recursively.
+    // Removed dirs are taken care of by the scan of their parent.
+    const QSet< QString > watched = m_watcher->directories().toSet();
+    QStringList flatDirs, newDirs;
+    foreach ( const QString& path, m_changedDirs )
+    {
+        QDir dir( path );
+        if ( !dir.exists() )
+            continue;
+
+        flatDirs << dir.canonicalPath();
+
+        dir.setFilter( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
+        foreach ( const QFileInfo& di, dir.entryInfoList() )
+        {
+            if ( !watched.contains( di.canonicalFilePath() ) )
+                newDirs << di.canonicalFilePath();
+        }
+    }
+    m_changedDirs.clear();
+
+    if ( flatDirs.isEmpty() )
+        return;
+
+    tDebug() << "Rescanning changed dirs:" << flatDirs << "new dirs:" << newDirs;
+    startScanner( new MusicScanner( newDirs, 0, flatDirs ) );
+}
+
+
 void
 ScanManager::scannerFinished()
 {
@@ -224,7 +363,7 @@ ScanManager::scannerFinished()
         m_musicScannerThreadController = 0;
     }
 
-    m_scanTimer->start();
+    m_scanTimer->start( scanInterval() );
     SourceList::instance()->getLocal()->scanningFinished( 0 );
     emit finished();
 }
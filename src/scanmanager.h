@@ -54,6 +54,10 @@ public slots:
 private slots:
     void scannerFinished();
 
+    void onDirectoryChanged( const QString& path );
+    void runWatchScan();
+    void addWatches( const QStringList& dirs );
+
     void runStartupScan();
     void scanTimerTimeout();
 
@@ -63,6 +67,10 @@ private slots:
     void filesDeleted();
 
 private:
+    void startScanner( MusicScanner* scanner );
+    bool isWatching() const;
+    int scanInterval() const;
+
     static ScanManager* s_instance;
 
     QWeakPointer< MusicScanner > m_scanner;
@@ -70,6 +78,13 @@ private:
     QStringList m_currScannerPaths;
 
     QTimer* m_scanTimer;
+
+    // event driven rescans: dirs reported by the watcher are collected until
+    // things settle down, then only those get rescanned
+    QFileSystemWatcher* m_watcher;
+    QTimer* m_watchTimer;
+    QSet< QString > m_changedDirs;
+    bool m_watchIncomplete;
 };
 
 #endif
@@ -46,6 +46,7 @@
 #include "playlist/dynamic/database/DatabaseGenerator.h"
 #include "playlist/XspfUpdater.h"
 #include "network/servent.h"
+#include "network/streamconnection.h"
 #include "web/api_v1.h"
 #include "sourcelist.h"
 #include "shortcuthandler.h"
@@ -398,6 +399,7 @@ TomahawkApp::registerMetaTypes()
     qRegisterMetaType< QList<QString> >("QList<QString>");
     qRegisterMetaType< QList<uint> >("QList<uint>");
     qRegisterMetaType< Connection* >("Connection*");
+    qRegisterMetaType< StreamConnection* >("StreamConnection*");
     qRegisterMetaType< QAbstractSocket::SocketError >("QAbstractSocket::SocketError");
     qRegisterMetaType< QTcpSocket* >("QTcpSocket*");
     qRegisterMetaType< QSharedPointer<QIODevice> >("QSharedPointer<QIODevice>");
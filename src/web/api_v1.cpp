@@ -261,7 +261,7 @@ Api_v1::resolve( QxtWebRequestEvent* event )
         qid = uuid();
 
     query_ptr qry = Query::get( QUrl::fromPercentEncoding( event->url.queryItemValue( "artist" ).toUtf8() ), QUrl::fromPercentEncoding( event->url.queryItemValue( "track" ).toUtf8() ), QUrl::fromPercentEncoding( event->url.queryItemValue( "album" ).toUtf8() ), qid, false );
-    Pipeline::instance()->resolve( qry, true, true );
+    Pipeline::instance()->resolve( qry, Pipeline::Interactive, true );
 
     QVariantMap r;
     r.insert( "qid", qid );
@@ -0,0 +1,203 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2012, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Checks TomahawkUtils::EditPattern against the original full matrix implementation
+ * and times both. Returns non-zero if any distance differs.
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+#include "utils/EditDistance.h"
+
+using namespace TomahawkUtils;
+
+static QTextStream out( stdout );
+static int s_failures = 0;
+
+
+static QString
+randomString( const QString& alphabet, int minLength, int maxLength )
+{
+    const int length = minLength + qrand() % ( maxLength - minLength + 1 );
+    QString s;
+    s.reserve( length );
+    for ( int i = 0; i < length; i++ )
+        s.append( alphabet.at( qrand() % alphabet.length() ) );
+
+    return s;
+}
+
+
+static void
+check( const QString& a, const QString& b )
+{
+    const int expected = EditPattern::referenceDistance( a, b );
+    const EditPattern pattern( a );
+
+    const int fast = pattern.distance( b );
+    const int matrix = EditPattern::distance( a, b, -1 );
+    if ( fast != expected || matrix != expected )
+    {
+        s_failures++;
+        out << "MISMATCH" << " \"" << a << "\" \"" << b << "\" reference: " << expected
+            << " pattern: " << fast << " matrix: " << matrix << endl;
+        return;
+    }
+
+    // with a cut-off the exact distance is only promised up to it
+    for ( int maxDistance = 0; maxDistance <= 4; maxDistance++ )
+    {
+        const int cut = pattern.distance( b, maxDistance );
+        const bool ok = ( expected <= maxDistance ) ? ( cut == expected ) : ( cut > maxDistance );
+        if ( !ok )
+        {
+            s_failures++;
+            out << "CUT-OFF MISMATCH" << " \"" << a << "\" \"" << b << "\" max: " << maxDistance
+                << " reference: " << expected << " pattern: " << cut << endl;
+        }
+    }
+}
+
+
+static void
+checkEdgeCases()
+{
+    const QString long64 = QString( "abcdefgh" ).repeated( 8 );
+    const QString unicode = QString::fromUtf8( "äöüßéñ日本語音楽" );
+    // a character outside the BMP takes two QChars
+    const QString surrogates = QString::fromUtf8( "a\xF0\x9F\x8E\xB5" "b\xF0\x9F\x8E\xB6" );
+
+    QList< QPair< QString, QString > > cases;
+    cases << qMakePair( QString(), QString() )
+          << qMakePair( QString(), QString( "abc" ) )
+          << qMakePair( QString( "abc" ), QString() )
+          << qMakePair( QString( "abc" ), QString( "abc" ) )
+          << qMakePair( QString( "ab" ), QString( "ba" ) )
+          << qMakePair( QString( "abc" ), QString( "bac" ) )
+          << qMakePair( QString( "abc" ), QString( "acb" ) )
+          << qMakePair( QString( "abcd" ), QString( "badc" ) )
+          << qMakePair( QString( "the beatles" ), QString( "beatles, the" ) )
+          << qMakePair( long64.left( 63 ), long64 )
+          << qMakePair( long64, long64.left( 63 ) )
+          << qMakePair( long64, long64 + "x" )
+          << qMakePair( long64 + "x", long64 )
+          << qMakePair( long64 + long64, long64 )
+          << qMakePair( long64, QString( "abc" ) )
+          << qMakePair( unicode, unicode.toUpper() )
+          << qMakePair( unicode, unicode.left( 6 ) + unicode.mid( 7 ) )
+          << qMakePair( surrogates, QString::fromUtf8( "a\xF0\x9F\x8E\xB6" "b\xF0\x9F\x8E\xB5" ) )
+          << qMakePair( surrogates, QString( "ab" ) );
+
+    for ( int i = 0; i < cases.count(); i++ )
+    {
+        check( cases.at( i ).first, cases.at( i ).second );
+        check( cases.at( i ).second, cases.at( i ).first );
+    }
+}
+
+
+static void
+checkRandom()
+{
+    const QString small = "abc";
+    const QString mixed = QString::fromUtf8( "abcdeäöß日本 " );
+
+    for ( int i = 0; i < 20000; i++ )
+        check( randomString( small, 0, 12 ), randomString( small, 0, 12 ) );
+    for ( int i = 0; i < 5000; i++ )
+        check( randomString( mixed, 0, 30 ), randomString( mixed, 0, 30 ) );
+    for ( int i = 0; i < 500; i++ )
+        check( randomString( small, 55, 80 ), randomString( small, 40, 90 ) );
+}
+
+
+static void
+benchmark()
+{
+    // roughly what scoring results does: a few names of a query against many candidates
+    const QString alphabet = "abcdefghijklmnopqrstuvwxyz ";
+    QStringList patterns, texts;
+    for ( int i = 0; i < 20; i++ )
+        patterns << randomString( alphabet, 5, 30 );
+    for ( int i = 0; i < 2000; i++ )
+        texts << randomString( alphabet, 5, 30 );
+
+    QElapsedTimer timer;
+    qint64 checksum = 0;
+
+    timer.start();
+    foreach ( const QString& p, patterns )
+        foreach ( const QString& t, texts )
+            checksum += EditPattern::referenceDistance( p, t );
+    const qint64 reference = timer.elapsed();
+
+    timer.restart();
+    foreach ( const QString& p, patterns )
+    {
+        const EditPattern pattern( p );
+        foreach ( const QString& t, texts )
+            checksum -= pattern.distance( t );
+    }
+    const qint64 fast = timer.elapsed();
+
+    timer.restart();
+    foreach ( const QString& p, patterns )
+    {
+        const EditPattern pattern( p );
+        foreach ( const QString& t, texts )
+            pattern.distance( t, p.length() / 3 );
+    }
+    const qint64 cutOff = timer.elapsed();
+
+    if ( checksum != 0 )
+    {
+        s_failures++;
+        out << "benchmark distances differ" << endl;
+    }
+
+    out << patterns.count() * texts.count() << " distances" << endl
+        << "  reference matrix:      " << reference << " ms" << endl
+        << "  EditPattern:           " << fast << " ms" << endl
+        << "  EditPattern, cut-off:  " << cutOff << " ms" << endl;
+}
+
+
+int
+main( int argc, char* argv[] )
+{
+    QCoreApplication app( argc, argv );
+    qsrand( 42 );
+
+    checkEdgeCases();
+    checkRandom();
+    benchmark();
+
+    if ( s_failures )
+    {
+        out << s_failures << " failures" << endl;
+        return 1;
+    }
+
+    out << "all distances match the reference" << endl;
+    return 0;
+}